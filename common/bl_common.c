@@ -11,6 +11,7 @@
 #include <bl_common.h>
 #include <debug.h>
 #include <errno.h>
+#include <image_decompress.h>
 #include <io_storage.h>
 #include <platform.h>
 #include <string.h>
@@ -202,6 +203,23 @@ static int load_image(unsigned int image_id, image_info_t *image_data)
 
 	image_data->image_size = image_size;
 
+#if IMAGE_DECOMPRESS_STREAM
+	/* Inflate the image while reading it, without staging it in memory */
+	if (image_decompress_stream_pending(image_data)) {
+		io_result = image_decompress_stream(image_data, image_handle,
+						    image_size);
+		if (io_result != 0) {
+			WARN("Failed to load image id=%u (%i)\n", image_id,
+			     io_result);
+		} else {
+			INFO("Image id=%u inflated: %p - %p\n", image_id,
+			     (void *) image_base,
+			     (void *) (image_base + image_data->image_size));
+		}
+		goto exit;
+	}
+#endif
+
 	/* We have enough space so load the image now */
 	/* TODO: Consider whether to try to recover/retry a partially successful read */
 	io_result = io_read(image_handle, image_base, image_size, &bytes_read);
@@ -9,12 +9,20 @@
 #include <bl_common.h>
 #include <debug.h>
 #include <image_decompress.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 static uintptr_t decompressor_buf_base;
 static uint32_t decompressor_buf_size;
 static decompressor_t *decompressor;
 static struct image_info saved_image_info;
+#if IMAGE_DECOMPRESS_STREAM
+static stream_decompressor_t *stream_decompressor;
+/* Image that load_image() has to inflate while reading it */
+static const struct image_info *stream_image;
+/* Image already inflated in place, nothing left for image_decompress() */
+static const struct image_info *streamed_image;
+#endif
 
 void image_decompress_init(uintptr_t buf_base, uint32_t buf_size,
 			   decompressor_t *_decompressor)
@@ -26,6 +34,14 @@ void image_decompress_init(uintptr_t buf_base, uint32_t buf_size,
 
 void image_decompress_prepare(struct image_info *info)
 {
+#if IMAGE_DECOMPRESS_STREAM
+	if (stream_decompressor != NULL) {
+		stream_image = info;
+		streamed_image = NULL;
+		return;
+	}
+#endif
+
 	/*
 	 * If the image is compressed, it should be loaded into the temporary
 	 * buffer instead of its final destination.  We save image_info, then
@@ -43,6 +59,13 @@ int image_decompress(struct image_info *info)
 	uint32_t compressed_image_size, work_size;
 	int ret;
 
+#if IMAGE_DECOMPRESS_STREAM
+	if (streamed_image == info) {
+		streamed_image = NULL;
+		return 0;
+	}
+#endif
+
 	/*
 	 * The size of compressed data has been filled by load_image().
 	 * Read it out before restoring image_info.
@@ -77,3 +100,52 @@ int image_decompress(struct image_info *info)
 
 	return 0;
 }
+
+#if IMAGE_DECOMPRESS_STREAM
+/*
+ * In streaming mode, the whole buffer is workspace of the decompressor:
+ * compressed data is read from storage by chunks and inflated straight to
+ * the image destination, so no buffer holds the full compressed image.
+ */
+void image_decompress_stream_init(uintptr_t buf_base, uint32_t buf_size,
+				  stream_decompressor_t *_decompressor)
+{
+	decompressor_buf_base = buf_base;
+	decompressor_buf_size = buf_size;
+	stream_decompressor = _decompressor;
+}
+
+/* Return true if load_image() is expected to stream this image */
+bool image_decompress_stream_pending(const struct image_info *info)
+{
+	return (stream_decompressor != NULL) && (stream_image == info);
+}
+
+int image_decompress_stream(struct image_info *info, uintptr_t image_handle,
+			    size_t image_size)
+{
+	uintptr_t image_base = info->image_base;
+	int ret;
+
+	assert(image_decompress_stream_pending(info));
+
+	stream_image = NULL;
+
+	ret = stream_decompressor(image_handle, image_size,
+				  &image_base, info->image_max_size,
+				  decompressor_buf_base, decompressor_buf_size);
+	if (ret != 0) {
+		ERROR("Failed to decompress image (err=%d)\n", ret);
+		return ret;
+	}
+
+	/* image_base is updated to the final pos when decompressor() exits. */
+	info->image_size = image_base - info->image_base;
+
+	flush_dcache_range(info->image_base, info->image_size);
+
+	streamed_image = info;
+
+	return 0;
+}
+#endif /* IMAGE_DECOMPRESS_STREAM */
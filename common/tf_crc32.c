@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2020, ARM Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <tf_crc32.h>
+
+/*
+ * Reflected CRC-32 (polynomial 0xEDB88320) of each 4-bit value. Processing a
+ * nibble at a time keeps the table at 64 bytes, where the byte-wise table of
+ * zlib is 1KB, or 8KB with its 4-byte variant. This is fast enough for the
+ * few KB of metadata it checks during boot.
+ */
+static const uint32_t crc32_nibble_table[16] = {
+	0x00000000U, 0x1DB71064U, 0x3B6E20C8U, 0x26D930ACU,
+	0x76DC4190U, 0x6B6B51F4U, 0x4DB26158U, 0x5005713CU,
+	0xEDB88320U, 0xF00F9344U, 0xD6D6A3E8U, 0xCB61B38CU,
+	0x9B64C2B0U, 0x86D3D2D4U, 0xA00AE278U, 0xBDBDF21CU,
+};
+
+/*
+ * Update crc with size bytes of buf. Start with a crc of 0; the value
+ * returned for a buffer can be passed back to continue with the next one.
+ */
+uint32_t tf_crc32(uint32_t crc, const unsigned char *buf, size_t size)
+{
+	size_t i;
+
+	crc = ~crc;
+
+	for (i = 0U; i < size; i++) {
+		crc ^= buf[i];
+		crc = (crc >> 4) ^ crc32_nibble_table[crc & 0xFU];
+		crc = (crc >> 4) ^ crc32_nibble_table[crc & 0xFU];
+	}
+
+	return ~crc;
+}
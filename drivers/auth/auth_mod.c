@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2015-2018, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2015-2020, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -289,6 +289,40 @@ int plat_set_nv_ctr2(void *cookie, const auth_img_desc_t *img_desc __unused,
 	return plat_set_nv_ctr(cookie, nv_ctr);
 }
 
+/*
+ * The parameters extracted from an authenticated image are kept in the CoT
+ * buffers, so that its children can be authenticated without loading it again
+ * (see auth_mod_get_parent_id()). A CoT may share a buffer between images that
+ * are not needed at the same time, e.g. the content certificate keys in the
+ * TBBR CoT: when such a buffer is overwritten, the image whose parameter it
+ * held is no longer considered as authenticated, and it will be loaded again
+ * if another of its children needs it.
+ */
+static void auth_release_param_buf(const auth_img_desc_t *img_desc,
+				   const void *buf)
+{
+	const auth_img_desc_t *desc;
+	unsigned int id;
+	int i;
+
+	for (id = 0U; id < MAX_NUMBER_IDS; id++) {
+		if ((id == img_desc->img_id) ||
+		    ((auth_img_flags[id] & IMG_FLAG_AUTHENTICATED) == 0U)) {
+			continue;
+		}
+
+		desc = &cot_desc_ptr[id];
+		for (i = 0 ; i < COT_MAX_VERIFIED_PARAMS ; i++) {
+			if ((desc->authenticated_data[i].type_desc != NULL) &&
+			    (desc->authenticated_data[i].data.ptr == buf)) {
+				VERBOSE("Image %u parameters released\n", id);
+				auth_img_flags[id] &= ~IMG_FLAG_AUTHENTICATED;
+				break;
+			}
+		}
+	}
+}
+
 /*
  * Return the parent id in the output parameter '*parent_id'
  *
@@ -404,6 +438,8 @@ int auth_mod_verify_img(unsigned int img_id,
 		}
 
 		/* Copy the parameter for later use */
+		auth_release_param_buf(img_desc,
+				img_desc->authenticated_data[i].data.ptr);
 		memcpy((void *)img_desc->authenticated_data[i].data.ptr,
 				(void *)param_ptr, param_len);
 	}
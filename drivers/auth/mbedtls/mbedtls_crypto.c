@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2015-2017, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2015-2020, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -45,6 +45,82 @@ static void init(void)
 	mbedtls_init();
 }
 
+#if TF_MBEDTLS_PK_CACHE_SIZE
+/*
+ * Parsed public keys, identified by the SHA-256 digest of their DER encoding.
+ * The same keys are used to check several certificates of the chain of trust,
+ * keeping them avoids parsing and checking them again, and lets mbed TLS keep
+ * precomputed data in their context.
+ */
+static struct {
+	unsigned char digest[32];
+	unsigned int len;
+	mbedtls_pk_context pk;
+} pk_cache[TF_MBEDTLS_PK_CACHE_SIZE];
+static unsigned int pk_cache_next;
+
+/* Free the cached keys but one, return the number of keys freed */
+static unsigned int pk_cache_flush(const mbedtls_pk_context *keep)
+{
+	unsigned int i, nb = 0U;
+
+	for (i = 0U; i < TF_MBEDTLS_PK_CACHE_SIZE; i++) {
+		if ((&pk_cache[i].pk != keep) &&
+		    (mbedtls_pk_get_type(&pk_cache[i].pk) != MBEDTLS_PK_NONE)) {
+			mbedtls_pk_free(&pk_cache[i].pk);
+			nb++;
+		}
+	}
+
+	return nb;
+}
+
+static mbedtls_pk_context *pk_cache_get(void *pk_ptr, unsigned int pk_len)
+{
+	const mbedtls_md_info_t *md_info;
+	unsigned char digest[32];
+	unsigned char *p, *end;
+	unsigned int i, slot;
+
+	md_info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+	if ((md_info == NULL) ||
+	    (mbedtls_md(md_info, pk_ptr, pk_len, digest) != 0)) {
+		return NULL;
+	}
+
+	slot = pk_cache_next;
+	for (i = 0U; i < TF_MBEDTLS_PK_CACHE_SIZE; i++) {
+		if (mbedtls_pk_get_type(&pk_cache[i].pk) == MBEDTLS_PK_NONE) {
+			slot = i;
+			continue;
+		}
+
+		if ((pk_cache[i].len == pk_len) &&
+		    (memcmp(pk_cache[i].digest, digest, sizeof(digest)) == 0)) {
+			return &pk_cache[i].pk;
+		}
+	}
+
+	if (slot == pk_cache_next) {
+		pk_cache_next = (pk_cache_next + 1U) % TF_MBEDTLS_PK_CACHE_SIZE;
+	}
+
+	mbedtls_pk_free(&pk_cache[slot].pk);
+	mbedtls_pk_init(&pk_cache[slot].pk);
+	p = (unsigned char *)pk_ptr;
+	end = (unsigned char *)(p + pk_len);
+	if (mbedtls_pk_parse_subpubkey(&p, end, &pk_cache[slot].pk) != 0) {
+		mbedtls_pk_free(&pk_cache[slot].pk);
+		return NULL;
+	}
+
+	memcpy(pk_cache[slot].digest, digest, sizeof(digest));
+	pk_cache[slot].len = pk_len;
+
+	return &pk_cache[slot].pk;
+}
+#endif /* TF_MBEDTLS_PK_CACHE_SIZE */
+
 /*
  * Verify a signature.
  *
@@ -60,12 +136,15 @@ static int verify_signature(void *data_ptr, unsigned int data_len,
 	mbedtls_asn1_buf signature;
 	mbedtls_md_type_t md_alg;
 	mbedtls_pk_type_t pk_alg;
-	mbedtls_pk_context pk = {0};
+	mbedtls_pk_context *pk;
 	int rc;
 	void *sig_opts = NULL;
 	const mbedtls_md_info_t *md_info;
 	unsigned char *p, *end;
 	unsigned char hash[MBEDTLS_MD_MAX_SIZE];
+#if !TF_MBEDTLS_PK_CACHE_SIZE
+	mbedtls_pk_context local_pk;
+#endif
 
 	/* Get pointers to signature OID and parameters */
 	p = (unsigned char *)sig_alg;
@@ -81,16 +160,6 @@ static int verify_signature(void *data_ptr, unsigned int data_len,
 		return CRYPTO_ERR_SIGNATURE;
 	}
 
-	/* Parse the public key */
-	mbedtls_pk_init(&pk);
-	p = (unsigned char *)pk_ptr;
-	end = (unsigned char *)(p + pk_len);
-	rc = mbedtls_pk_parse_subpubkey(&p, end, &pk);
-	if (rc != 0) {
-		rc = CRYPTO_ERR_SIGNATURE;
-		goto end2;
-	}
-
 	/* Get the signature (bitstring) */
 	p = (unsigned char *)sig_ptr;
 	end = (unsigned char *)(p + sig_len);
@@ -98,7 +167,7 @@ static int verify_signature(void *data_ptr, unsigned int data_len,
 	rc = mbedtls_asn1_get_bitstring_null(&p, end, &signature.len);
 	if (rc != 0) {
 		rc = CRYPTO_ERR_SIGNATURE;
-		goto end1;
+		goto end2;
 	}
 	signature.p = p;
 
@@ -106,19 +175,50 @@ static int verify_signature(void *data_ptr, unsigned int data_len,
 	md_info = mbedtls_md_info_from_type(md_alg);
 	if (md_info == NULL) {
 		rc = CRYPTO_ERR_SIGNATURE;
-		goto end1;
+		goto end2;
 	}
 	p = (unsigned char *)data_ptr;
 	rc = mbedtls_md(md_info, p, data_len, hash);
+	if (rc != 0) {
+		rc = CRYPTO_ERR_SIGNATURE;
+		goto end2;
+	}
+
+	/* Get the parsed public key */
+#if TF_MBEDTLS_PK_CACHE_SIZE
+	pk = pk_cache_get(pk_ptr, pk_len);
+	if ((pk == NULL) && (pk_cache_flush(NULL) != 0U)) {
+		/* Parsing may have failed because the heap is full */
+		pk = pk_cache_get(pk_ptr, pk_len);
+	}
+	if (pk == NULL) {
+		rc = CRYPTO_ERR_SIGNATURE;
+		goto end2;
+	}
+#else
+	pk = &local_pk;
+	mbedtls_pk_init(pk);
+	p = (unsigned char *)pk_ptr;
+	end = (unsigned char *)(p + pk_len);
+	rc = mbedtls_pk_parse_subpubkey(&p, end, pk);
 	if (rc != 0) {
 		rc = CRYPTO_ERR_SIGNATURE;
 		goto end1;
 	}
+#endif
 
 	/* Verify the signature */
-	rc = mbedtls_pk_verify_ext(pk_alg, sig_opts, &pk, md_alg, hash,
+	rc = mbedtls_pk_verify_ext(pk_alg, sig_opts, pk, md_alg, hash,
 			mbedtls_md_get_size(md_info),
 			signature.p, signature.len);
+#if TF_MBEDTLS_PK_CACHE_SIZE
+	if ((rc != 0) && (pk_cache_flush(pk) != 0U)) {
+		/* Retry with the heap used by the other keys */
+		rc = mbedtls_pk_verify_ext(pk_alg, sig_opts, pk, md_alg, hash,
+				mbedtls_md_get_size(md_info),
+				signature.p, signature.len);
+	}
+#endif
 	if (rc != 0) {
 		rc = CRYPTO_ERR_SIGNATURE;
 		goto end1;
@@ -128,7 +228,9 @@ static int verify_signature(void *data_ptr, unsigned int data_len,
 	rc = CRYPTO_SUCCESS;
 
 end1:
-	mbedtls_pk_free(&pk);
+#if !TF_MBEDTLS_PK_CACHE_SIZE
+	mbedtls_pk_free(pk);
+#endif
 end2:
 	mbedtls_free(sig_opts);
 	return rc;
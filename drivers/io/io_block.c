@@ -14,11 +14,23 @@
 #include <string.h>
 #include <utils.h>
 
+#if PLAT_IO_BLOCK_CACHE_LINES
+typedef struct {
+	int			lba;	/* first block held by the line */
+	size_t			length;	/* valid bytes, 0 if the line is free */
+	unsigned int		stamp;	/* last access, for LRU replacement */
+} block_cache_line_t;
+#endif
+
 typedef struct {
 	io_block_dev_spec_t	*dev_spec;
 	uintptr_t		base;
 	size_t			file_pos;
 	size_t			size;
+#if PLAT_IO_BLOCK_CACHE_LINES
+	block_cache_line_t	lines[PLAT_IO_BLOCK_CACHE_LINES];
+	unsigned int		stamp;
+#endif
 } block_dev_state_t;
 
 #define is_power_of_2(x)	((x != 0) && ((x & (x - 1)) == 0))
@@ -58,6 +70,9 @@ static io_dev_info_t dev_info_pool[MAX_IO_BLOCK_DEVICES];
 /* Track number of allocated block state */
 static unsigned int block_dev_count;
 
+/* Cache statistics, accumulated over all the block devices */
+static io_block_cache_stats_t cache_stats;
+
 io_type_t device_type_block(void)
 {
 	return IO_TYPE_BLOCK;
@@ -169,6 +184,122 @@ static int block_seek(io_entity_t *entity, int mode, signed long long offset)
 	return 0;
 }
 
+#if PLAT_IO_BLOCK_CACHE_LINES
+static size_t cache_line_size(const io_block_dev_spec_t *dev_spec)
+{
+	return dev_spec->cache.length / PLAT_IO_BLOCK_CACHE_LINES;
+}
+
+static void cache_invalidate(block_dev_state_t *cur)
+{
+	zeromem(cur->lines, sizeof(cur->lines));
+	cur->stamp = 0U;
+}
+
+/*
+ * Return the index of the cache line holding lba with at least min_length
+ * valid bytes, loading it from the device on a miss. The line is filled up
+ * to its size, or up to the end of the opened region, so that subsequent
+ * sequential reads are served from memory. The least recently used line is
+ * evicted, unless a line already tagged with lba holds less data.
+ */
+static int cache_get_line(block_dev_state_t *cur, int lba, size_t min_length)
+{
+	io_block_dev_spec_t *dev_spec = cur->dev_spec;
+	block_cache_line_t *line;
+	size_t line_size = cache_line_size(dev_spec);
+	size_t region_end = cur->base + cur->size;
+	size_t line_pos = (size_t)lba * dev_spec->block_size;
+	size_t request;
+	unsigned int index;
+	unsigned int victim = 0U;
+
+	for (index = 0U; index < PLAT_IO_BLOCK_CACHE_LINES; index++) {
+		line = &cur->lines[index];
+
+		if ((line->length != 0U) && (line->lba == lba)) {
+			if (line->length > min_length) {
+				cache_stats.hits++;
+				line->stamp = ++cur->stamp;
+				return (int)index;
+			}
+
+			victim = index;
+			break;
+		}
+
+		if (line->stamp < cur->lines[victim].stamp) {
+			victim = index;
+		}
+	}
+
+	cache_stats.misses++;
+	line = &cur->lines[victim];
+
+	/* Device reads are whole blocks, including a partial last one */
+	request = line_size;
+	if ((region_end > line_pos) && ((region_end - line_pos) < request)) {
+		request = round_up(region_end - line_pos,
+				   dev_spec->block_size);
+		if (request > line_size) {
+			request = line_size;
+		}
+	}
+
+	request = dev_spec->ops.read(lba, dev_spec->cache.offset +
+				     (victim * line_size), request);
+	if (request <= min_length) {
+		line->length = 0U;
+		line->stamp = 0U;
+		return -EIO;
+	}
+
+	line->lba = lba;
+	line->length = request;
+	line->stamp = ++cur->stamp;
+
+	return (int)victim;
+}
+
+/* Same as block_read() below, except that data are read from cache lines */
+static int block_read_cached(block_dev_state_t *cur, uintptr_t buffer,
+			     size_t length)
+{
+	io_block_dev_spec_t *dev_spec = cur->dev_spec;
+	size_t line_size = cache_line_size(dev_spec);
+	size_t count = 0U;
+	size_t left, nbytes, skip, pos;
+	int index;
+
+	for (left = length; left > 0U; left -= nbytes) {
+		pos = cur->base + cur->file_pos;
+		skip = pos % line_size;
+
+		index = cache_get_line(cur,
+				       (int)((pos - skip) / dev_spec->block_size),
+				       skip);
+		if (index < 0) {
+			return index;
+		}
+
+		nbytes = cur->lines[index].length - skip;
+		if (nbytes > left) {
+			nbytes = left;
+		}
+
+		memcpy((void *)(buffer + count),
+		       (void *)(dev_spec->cache.offset + (index * line_size) +
+				skip),
+		       nbytes);
+
+		cur->file_pos += nbytes;
+		count += nbytes;
+	}
+
+	return 0;
+}
+#endif /* PLAT_IO_BLOCK_CACHE_LINES */
+
 /*
  * This function allows the caller to read any number of bytes
  * from any position. It hides from the caller that the low level
@@ -238,6 +369,9 @@ static int block_seek(io_entity_t *entity, int mode, signed long long offset)
  *
  * Additionally, the IO driver has an underlying buffer that is at least
  * one block-size and may be big enough to allow.
+ *
+ * When the platform provides a cache in the device specification, the
+ * request is served from cache lines instead (see block_read_cached()).
  */
 static int block_read(io_entity_t *entity, uintptr_t buffer, size_t length,
 		      size_t *length_read)
@@ -271,6 +405,18 @@ static int block_read(io_entity_t *entity, uintptr_t buffer, size_t length,
 	       (length > 0) &&
 	       (ops->read != 0));
 
+#if PLAT_IO_BLOCK_CACHE_LINES
+	if (cur->dev_spec->cache.length != 0U) {
+		int result = block_read_cached(cur, buffer, length);
+
+		if (result == 0) {
+			*length_read = length;
+		}
+
+		return result;
+	}
+#endif
+
 	/*
 	 * We don't know the number of bytes that we are going
 	 * to read in every iteration, because it will depend
@@ -383,6 +529,11 @@ static int block_write(io_entity_t *entity, const uintptr_t buffer,
 	       (ops->read != 0) &&
 	       (ops->write != 0));
 
+#if PLAT_IO_BLOCK_CACHE_LINES
+	/* Written blocks may be held by the cache */
+	cache_invalidate(cur);
+#endif
+
 	/*
 	 * We don't know the number of bytes that we are going
 	 * to write in every iteration, because it will depend
@@ -515,6 +666,13 @@ static int block_dev_open(const uintptr_t dev_spec, io_dev_info_t **dev_info)
 	       (is_power_of_2(block_size) != 0) &&
 	       ((buffer->offset % block_size) == 0) &&
 	       ((buffer->length % block_size) == 0));
+#if PLAT_IO_BLOCK_CACHE_LINES
+	assert((cur->dev_spec->cache.length == 0U) ||
+	       ((cache_line_size(cur->dev_spec) != 0U) &&
+		((cache_line_size(cur->dev_spec) % block_size) == 0U)));
+
+	cache_invalidate(cur);
+#endif
 
 	*dev_info = info;	/* cast away const */
 	(void)block_size;
@@ -529,6 +687,14 @@ static int block_dev_close(io_dev_info_t *dev_info)
 
 /* Exported functions */
 
+/* Return the cache hit/miss counters of all block devices */
+void io_block_get_cache_stats(io_block_cache_stats_t *stats)
+{
+	assert(stats != NULL);
+
+	*stats = cache_stats;
+}
+
 /* Register the Block driver with the IO abstraction */
 int register_io_dev_block(const io_dev_connector_t **dev_con)
 {
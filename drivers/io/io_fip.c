@@ -23,6 +23,22 @@
 #define MAX_FIP_DEVICES		1
 #endif
 
+/*
+ * Maximum number of ToC entries indexed by fip_dev_init(). Files past them
+ * are found by scanning the rest of the ToC from the backend. BL1 only loads
+ * BL2 from the FIP, so it doesn't index it by default.
+ */
+#ifndef MAX_FIP_TOC_ENTRIES
+#ifdef IMAGE_BL1
+#define MAX_FIP_TOC_ENTRIES	0
+#else
+#define MAX_FIP_TOC_ENTRIES	32
+#endif
+#endif
+
+/* Number of ToC entries read from the backend at once */
+#define FIP_TOC_READ_ENTRIES	8
+
 /* Useful for printing UUIDs when debugging.*/
 #define PRINT_UUID2(x)								\
 	"%08x-%04hx-%04hx-%02hhx%02hhx-%02hhx%02hhx%02hhx%02hhx%02hhx%02hhx",	\
@@ -46,6 +62,28 @@ typedef struct {
 	uintptr_t dev_spec;
 } fip_dev_state_t;
 
+/* ToC entry as kept in the index, without the unused flags */
+typedef struct {
+	uuid_t uuid;
+	uint64_t offset_address;
+	uint64_t size;
+} fip_index_entry_t;
+
+/*
+ * Table of Contents of the FIP parsed by fip_dev_init(), sorted by UUID so
+ * that files are looked up without going back to the backend.
+ */
+typedef struct {
+	unsigned int image_id;
+	unsigned int nb_entries;
+	int valid;
+	/* Backend offset of the first entry not indexed, 0 if there is none */
+	size_t scan_offset;
+#if MAX_FIP_TOC_ENTRIES > 0
+	fip_index_entry_t entries[MAX_FIP_TOC_ENTRIES];
+#endif
+} fip_toc_index_t;
+
 static const uuid_t uuid_null = { {0} };
 /*
  * Only one file can be open across all FIP device
@@ -57,6 +95,7 @@ static const uuid_t uuid_null = { {0} };
 static file_state_t current_file = {0};
 static uintptr_t backend_dev_handle;
 static uintptr_t backend_image_spec;
+static fip_toc_index_t toc_index;
 
 static fip_dev_state_t state_pool[MAX_FIP_DEVICES];
 static io_dev_info_t dev_info_pool[MAX_FIP_DEVICES];
@@ -211,7 +250,162 @@ static int fip_dev_open(const uintptr_t dev_spec,
 }
 
 
-/* Do some basic package checks. */
+#if MAX_FIP_TOC_ENTRIES > 0
+/* Find the first index entry of a UUID, or where it would be inserted */
+static unsigned int toc_index_lookup(const uuid_t *uuid)
+{
+	unsigned int low = 0U;
+	unsigned int high = toc_index.nb_entries;
+
+	while (low < high) {
+		unsigned int mid = (low + high) / 2U;
+
+		if (compare_uuids(&toc_index.entries[mid].uuid, uuid) < 0) {
+			low = mid + 1U;
+		} else {
+			high = mid;
+		}
+	}
+
+	return low;
+}
+
+/* Insert a ToC entry in the index, after any entry with the same UUID */
+static void toc_index_add(const fip_toc_entry_t *entry)
+{
+	fip_index_entry_t *slot;
+	unsigned int pos;
+
+	assert(toc_index.nb_entries < (unsigned int)MAX_FIP_TOC_ENTRIES);
+
+	pos = toc_index.nb_entries;
+	while ((pos > 0U) &&
+	       (compare_uuids(&toc_index.entries[pos - 1U].uuid,
+			      &entry->uuid) > 0)) {
+		toc_index.entries[pos] = toc_index.entries[pos - 1U];
+		pos--;
+	}
+
+	slot = &toc_index.entries[pos];
+	slot->uuid = entry->uuid;
+	slot->offset_address = entry->offset_address;
+	slot->size = entry->size;
+	toc_index.nb_entries++;
+}
+
+/*
+ * Index the Table of Contents, which ends with a null UUID. When it has more
+ * than MAX_FIP_TOC_ENTRIES entries, the offset of the first one left out is
+ * kept in scan_offset.
+ */
+static int toc_index_build(uintptr_t backend_handle)
+{
+	fip_toc_entry_t entries[FIP_TOC_READ_ENTRIES];
+	size_t offset = sizeof(fip_toc_header_t);
+	size_t fip_size = SIZE_MAX;
+	size_t length, bytes_read;
+	unsigned int i;
+	int result;
+
+	toc_index.nb_entries = 0U;
+	toc_index.scan_offset = 0U;
+
+	/* Don't read past the end of the backend if it can tell its size */
+	if (io_size(backend_handle, &length) == 0) {
+		fip_size = length;
+	}
+
+	for (;;) {
+		if (offset >= fip_size) {
+			WARN("FIP ToC is not terminated\n");
+			return -ENOENT;
+		}
+
+		length = fip_size - offset;
+		if (length > sizeof(entries)) {
+			length = sizeof(entries);
+		}
+
+		result = io_seek(backend_handle, IO_SEEK_SET, offset);
+		if (result != 0) {
+			WARN("fip_dev_init: failed to seek\n");
+			return -ENOENT;
+		}
+
+		result = io_read(backend_handle, (uintptr_t)entries, length,
+				 &bytes_read);
+		if (result != 0) {
+			WARN("Failed to read FIP (%i)\n", result);
+			return result;
+		}
+
+		if (bytes_read < sizeof(fip_toc_entry_t)) {
+			WARN("FIP ToC is not terminated\n");
+			return -ENOENT;
+		}
+
+		for (i = 0U; i < (bytes_read / sizeof(fip_toc_entry_t)); i++) {
+			if (compare_uuids(&entries[i].uuid, &uuid_null) == 0) {
+				return 0;
+			}
+
+			if (toc_index.nb_entries ==
+			    (unsigned int)MAX_FIP_TOC_ENTRIES) {
+				VERBOSE("FIP ToC has more than %u entries\n",
+					(unsigned int)MAX_FIP_TOC_ENTRIES);
+				toc_index.scan_offset = offset +
+					(i * sizeof(fip_toc_entry_t));
+				return 0;
+			}
+
+			toc_index_add(&entries[i]);
+		}
+
+		offset += i * sizeof(fip_toc_entry_t);
+	}
+}
+
+/* Look a file up in the index, return 0 and its ToC entry if it is found */
+static int toc_index_find(const uuid_t *uuid, fip_toc_entry_t *entry)
+{
+	const fip_index_entry_t *found;
+	unsigned int pos;
+
+	pos = toc_index_lookup(uuid);
+	if ((pos == toc_index.nb_entries) ||
+	    (compare_uuids(&toc_index.entries[pos].uuid, uuid) != 0)) {
+		return -ENOENT;
+	}
+
+	found = &toc_index.entries[pos];
+	entry->uuid = found->uuid;
+	entry->offset_address = found->offset_address;
+	entry->size = found->size;
+	entry->flags = 0U;
+
+	return 0;
+}
+#else
+static int toc_index_build(uintptr_t backend_handle)
+{
+	toc_index.nb_entries = 0U;
+	toc_index.scan_offset = sizeof(fip_toc_header_t);
+
+	return 0;
+}
+
+static int toc_index_find(const uuid_t *uuid, fip_toc_entry_t *entry)
+{
+	return -ENOENT;
+}
+#endif /* MAX_FIP_TOC_ENTRIES > 0 */
+
+/*
+ * Do some basic package checks, and index its Table of Contents. Platforms
+ * call this before each image load, so the index is reused as long as the
+ * same image is used as FIP. The backend is only opened while it is
+ * accessed, as backends like io_memmap support a single open file.
+ */
 static int fip_dev_init(io_dev_info_t *dev_info, const uintptr_t init_params)
 {
 	int result;
@@ -220,6 +414,12 @@ static int fip_dev_init(io_dev_info_t *dev_info, const uintptr_t init_params)
 	fip_toc_header_t header;
 	size_t bytes_read;
 
+	if ((toc_index.valid != 0) && (toc_index.image_id == image_id)) {
+		return 0;
+	}
+
+	toc_index.valid = 0;
+
 	/* Obtain a reference to the image by querying the platform layer */
 	result = plat_get_image_source(image_id, &backend_dev_handle,
 				       &backend_image_spec);
@@ -241,15 +441,27 @@ static int fip_dev_init(io_dev_info_t *dev_info, const uintptr_t init_params)
 
 	result = io_read(backend_handle, (uintptr_t)&header, sizeof(header),
 			&bytes_read);
+	if (result != 0) {
+		goto fip_dev_init_close;
+	}
+
+	if (!is_valid_header(&header)) {
+		WARN("Firmware Image Package header check failed.\n");
+		result = -ENOENT;
+		goto fip_dev_init_close;
+	}
+
+	VERBOSE("FIP header looks OK.\n");
+
+	result = toc_index_build(backend_handle);
 	if (result == 0) {
-		if (!is_valid_header(&header)) {
-			WARN("Firmware Image Package header check failed.\n");
-			result = -ENOENT;
-		} else {
-			VERBOSE("FIP header looks OK.\n");
-		}
+		VERBOSE("FIP ToC indexed, %u entries.\n",
+			toc_index.nb_entries);
+		toc_index.image_id = image_id;
+		toc_index.valid = 1;
 	}
 
+ fip_dev_init_close:
 	io_close(backend_handle);
 
  fip_dev_init_exit:
@@ -262,6 +474,7 @@ static int fip_dev_close(io_dev_info_t *dev_info)
 	/* TODO: Consider tracking open files and cleaning them up here */
 
 	/* Clear the backend. */
+	toc_index.valid = 0;
 	backend_dev_handle = (uintptr_t)NULL;
 	backend_image_spec = (uintptr_t)NULL;
 
@@ -269,29 +482,15 @@ static int fip_dev_close(io_dev_info_t *dev_info)
 }
 
 
-/* Open a file for access from package. */
-static int fip_file_open(io_dev_info_t *dev_info, const uintptr_t spec,
-			 io_entity_t *entity)
+/*
+ * Look for a file in the ToC entries that are not indexed, starting at
+ * scan_offset. On success, current_file.entry holds its ToC entry.
+ */
+static int fip_toc_scan(const uuid_t *uuid)
 {
 	int result;
 	uintptr_t backend_handle;
-	const io_uuid_spec_t *uuid_spec = (io_uuid_spec_t *)spec;
 	size_t bytes_read;
-	int found_file = 0;
-
-	assert(uuid_spec != NULL);
-	assert(entity != NULL);
-
-	/* Can only have one file open at a time for the moment. We need to
-	 * track state like file cursor position. We know the header lives at
-	 * offset zero, so this entry should never be zero for an active file.
-	 * When the system supports dynamic memory allocation we can allow more
-	 * than one open file at a time if needed.
-	 */
-	if (current_file.entry.offset_address != 0) {
-		WARN("fip_file_open : Only one open file at a time.\n");
-		return -ENOMEM;
-	}
 
 	/* Attempt to access the FIP image */
 	result = io_open(backend_dev_handle, backend_image_spec,
@@ -299,55 +498,91 @@ static int fip_file_open(io_dev_info_t *dev_info, const uintptr_t spec,
 	if (result != 0) {
 		WARN("Failed to open Firmware Image Package (%i)\n", result);
 		result = -ENOENT;
-		goto fip_file_open_exit;
+		goto fip_toc_scan_exit;
 	}
 
-	/* Seek past the FIP header into the Table of Contents */
-	result = io_seek(backend_handle, IO_SEEK_SET, sizeof(fip_toc_header_t));
+	result = io_seek(backend_handle, IO_SEEK_SET, toc_index.scan_offset);
 	if (result != 0) {
 		WARN("fip_file_open: failed to seek\n");
 		result = -ENOENT;
-		goto fip_file_open_close;
+		goto fip_toc_scan_close;
 	}
 
-	found_file = 0;
 	do {
 		result = io_read(backend_handle,
 				 (uintptr_t)&current_file.entry,
 				 sizeof(current_file.entry),
 				 &bytes_read);
-		if (result == 0) {
-			if (compare_uuids(&current_file.entry.uuid,
-					  &uuid_spec->uuid) == 0) {
-				found_file = 1;
-				break;
-			}
-		} else {
+		if (result != 0) {
 			WARN("Failed to read FIP (%i)\n", result);
-			goto fip_file_open_close;
+			goto fip_toc_scan_close;
+		}
+
+		if (compare_uuids(&current_file.entry.uuid, uuid) == 0) {
+			goto fip_toc_scan_close;
 		}
 	} while (compare_uuids(&current_file.entry.uuid, &uuid_null) != 0);
 
-	if (found_file == 1) {
-		/* All fine. Update entity info with file state and return. Set
-		 * the file position to 0. The 'current_file.entry' holds the
-		 * base and size of the file.
-		 */
-		current_file.file_pos = 0;
-		entity->info = (uintptr_t)&current_file;
-	} else {
-		/* Did not find the file in the FIP. */
-		current_file.entry.offset_address = 0;
-		result = -ENOENT;
-	}
+	/* Did not find the file in the FIP. */
+	result = -ENOENT;
 
- fip_file_open_close:
+ fip_toc_scan_close:
 	io_close(backend_handle);
 
- fip_file_open_exit:
+	if (result != 0) {
+		current_file.entry.offset_address = 0;
+	}
+
+ fip_toc_scan_exit:
 	return result;
 }
 
+/* Open a file for access from package. */
+static int fip_file_open(io_dev_info_t *dev_info, const uintptr_t spec,
+			 io_entity_t *entity)
+{
+	int result;
+	const io_uuid_spec_t *uuid_spec = (io_uuid_spec_t *)spec;
+
+	assert(uuid_spec != NULL);
+	assert(entity != NULL);
+
+	/* Can only have one file open at a time for the moment. We need to
+	 * track state like file cursor position. We know the header lives at
+	 * offset zero, so this entry should never be zero for an active file.
+	 * When the system supports dynamic memory allocation we can allow more
+	 * than one open file at a time if needed.
+	 */
+	if (current_file.entry.offset_address != 0) {
+		WARN("fip_file_open : Only one open file at a time.\n");
+		return -ENOMEM;
+	}
+
+	if (toc_index.valid == 0) {
+		WARN("Failed to open Firmware Image Package\n");
+		return -ENOENT;
+	}
+
+	/* Index hits are first occurrences, as the index holds a ToC prefix */
+	result = toc_index_find(&uuid_spec->uuid, &current_file.entry);
+	if ((result != 0) && (toc_index.scan_offset != 0U)) {
+		result = fip_toc_scan(&uuid_spec->uuid);
+	}
+
+	if (result != 0) {
+		return result;
+	}
+
+	/* All fine. Update entity info with file state and return. Set
+	 * the file position to 0. The 'current_file.entry' holds the
+	 * base and size of the file.
+	 */
+	current_file.file_pos = 0;
+	entity->info = (uintptr_t)&current_file;
+
+	return 0;
+}
+
 
 /* Return the size of a file in package */
 static int fip_file_len(io_entity_t *entity, size_t *length)
@@ -561,19 +561,15 @@ static int mmc_enumerate(unsigned int clk, unsigned int bus_width)
 	return ret;
 }
 
-size_t mmc_read_blocks(int lba, uintptr_t buf, size_t size)
+/* Set up the controller and send the read command, without waiting for data */
+static int mmc_read_submit(int lba, uintptr_t buf, size_t size)
 {
 	int ret;
 	unsigned int cmd_idx, cmd_arg;
 
-	assert((ops != NULL) &&
-	       (ops->read != NULL) &&
-	       (size != 0U) &&
-	       ((size & MMC_BLOCK_MASK) == 0U));
-
 	ret = ops->prepare(lba, buf, size);
 	if (ret != 0) {
-		return 0;
+		return ret;
 	}
 
 	if (is_cmd23_enabled()) {
@@ -581,7 +577,7 @@ size_t mmc_read_blocks(int lba, uintptr_t buf, size_t size)
 		ret = mmc_send_cmd(MMC_CMD(23), size / MMC_BLOCK_SIZE,
 				   MMC_RESPONSE_R1, NULL);
 		if (ret != 0) {
-			return 0;
+			return ret;
 		}
 
 		cmd_idx = MMC_CMD(18);
@@ -600,34 +596,149 @@ size_t mmc_read_blocks(int lba, uintptr_t buf, size_t size)
 		cmd_arg = lba;
 	}
 
-	ret = mmc_send_cmd(cmd_idx, cmd_arg, MMC_RESPONSE_R1, NULL);
-	if (ret != 0) {
-		return 0;
-	}
+	return mmc_send_cmd(cmd_idx, cmd_arg, MMC_RESPONSE_R1, NULL);
+}
 
-	ret = ops->read(lba, buf, size);
+/* Send the read command sequence and transfer the data */
+static int mmc_read_transfer(int lba, uintptr_t buf, size_t size)
+{
+	int ret;
+
+	ret = mmc_read_submit(lba, buf, size);
 	if (ret != 0) {
-		return 0;
+		return ret;
 	}
 
+	return ops->read(lba, buf, size);
+}
+
+/* Wait for the device to be done with a read, and stop it if open-ended */
+static int mmc_read_complete(size_t size)
+{
+	int ret;
+
 	/* Wait buffer empty */
 	do {
 		ret = mmc_device_state();
 		if (ret < 0) {
-			return 0;
+			return ret;
 		}
 	} while ((ret != MMC_STATE_TRAN) && (ret != MMC_STATE_DATA));
 
 	if (!is_cmd23_enabled() && (size > MMC_BLOCK_SIZE)) {
 		ret = mmc_send_cmd(MMC_CMD(12), 0, MMC_RESPONSE_R1B, NULL);
 		if (ret != 0) {
-			return 0;
+			return ret;
 		}
 	}
 
+	return 0;
+}
+
+size_t mmc_read_blocks(int lba, uintptr_t buf, size_t size)
+{
+	assert((ops != NULL) &&
+	       (ops->read != NULL) &&
+	       (size != 0U) &&
+	       ((size & MMC_BLOCK_MASK) == 0U));
+
+	if ((mmc_read_transfer(lba, buf, size) != 0) ||
+	    (mmc_read_complete(size) != 0)) {
+		return 0;
+	}
+
 	return size;
 }
 
+/*
+ * Start reading blocks and return without waiting for the data when the
+ * driver can complete reads asynchronously, so that the caller can work on
+ * a previous buffer in the meantime. Only one read can be in flight, and it
+ * must be ended with mmc_read_blocks_poll() or mmc_read_blocks_wait(). A
+ * zero-size read completes at once, without any command.
+ */
+int mmc_read_blocks_start(struct mmc_read_req *req, int lba, uintptr_t buf,
+			  size_t size)
+{
+	int ret;
+
+	assert((ops != NULL) &&
+	       (ops->read != NULL) &&
+	       (req != NULL) &&
+	       ((size & MMC_BLOCK_MASK) == 0U));
+
+	req->lba = lba;
+	req->buf = buf;
+	req->size = size;
+	req->status = 0;
+
+	if (size == 0U) {
+		return 0;
+	}
+
+	ret = mmc_read_submit(lba, buf, size);
+	if ((ret == 0) && (ops->read_poll == NULL)) {
+		ret = ops->read(lba, buf, size);
+		if (ret == 0) {
+			ret = mmc_read_complete(size);
+		}
+	} else if (ret == 0) {
+		ret = -EBUSY;
+	}
+
+	req->status = ret;
+
+	return (ret == -EBUSY) ? 0 : ret;
+}
+
+/* Return -EBUSY while the read is in flight, else its final status */
+int mmc_read_blocks_poll(struct mmc_read_req *req)
+{
+	int ret;
+
+	assert(req != NULL);
+
+	if (req->status != -EBUSY) {
+		return req->status;
+	}
+
+	ret = ops->read_poll(req->lba, req->buf, req->size);
+	if (ret == -EBUSY) {
+		return ret;
+	}
+
+	if (ret == 0) {
+		ret = mmc_read_complete(req->size);
+	}
+
+	req->status = ret;
+
+	return ret;
+}
+
+/* Wait for the read to end, return the number of bytes read */
+size_t mmc_read_blocks_wait(struct mmc_read_req *req)
+{
+	int ret;
+
+	assert(req != NULL);
+
+	if (req->status == -EBUSY) {
+		ret = ops->read(req->lba, req->buf, req->size);
+		if (ret == 0) {
+			ret = mmc_read_complete(req->size);
+		}
+
+		req->status = ret;
+	}
+
+	if (req->status != 0) {
+		return 0U;
+	}
+
+	return req->size;
+}
+
 size_t mmc_write_blocks(int lba, const uintptr_t buf, size_t size)
 {
 	int ret;
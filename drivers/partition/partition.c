@@ -6,6 +6,7 @@
 
 #include <assert.h>
 #include <debug.h>
+#include <errno.h>
 #include <gpt.h>
 #include <io_storage.h>
 #include <mbr.h>
@@ -13,10 +14,25 @@
 #include <platform.h>
 #include <stdio.h>
 #include <string.h>
+#include <tf_crc32.h>
+#include <utils_def.h>
+
+/* Smallest valid size of a GPT header, as covered by its CRC */
+#define GPT_HEADER_MIN_SIZE	92U
 
 static uint8_t mbr_sector[PARTITION_BLOCK_SIZE];
+static uint8_t entry_buf[PLAT_PARTITION_ENTRY_BUF_SIZE] __aligned(16);
 partition_entry_list_t list;
 
+/*
+ * Partition names hashes, sorted, with the index of the matching entries
+ * in list, so that get_partition_entry() doesn't compare every name.
+ */
+static struct {
+	uint32_t	hash[PLAT_PARTITION_MAX_ENTRIES];
+	uint8_t		index[PLAT_PARTITION_MAX_ENTRIES];
+} name_index;
+
 #if LOG_LEVEL >= LOG_LEVEL_VERBOSE
 static void dump_entries(int num)
 {
@@ -73,63 +89,144 @@ static int load_mbr_header(uintptr_t image_handle, mbr_entry_t *mbr_entry)
 }
 
 /*
- * Load GPT header and check the GPT signature.
+ * Load GPT header and check the GPT signature and header CRC.
  * If partiton numbers could be found, check & update it.
  */
-static int load_gpt_header(uintptr_t image_handle)
+static int load_gpt_header(uintptr_t image_handle, gpt_header_t *header)
 {
-	gpt_header_t header;
 	size_t bytes_read;
+	uint32_t crc;
 	int result;
 
 	result = io_seek(image_handle, IO_SEEK_SET, GPT_HEADER_OFFSET);
 	if (result != 0) {
 		return result;
 	}
-	result = io_read(image_handle, (uintptr_t)&header,
-			 sizeof(gpt_header_t), &bytes_read);
-	if ((result != 0) || (sizeof(gpt_header_t) != bytes_read)) {
-		return result;
+	result = io_read(image_handle, (uintptr_t)&mbr_sector,
+			 PARTITION_BLOCK_SIZE, &bytes_read);
+	if ((result != 0) || (bytes_read != PARTITION_BLOCK_SIZE)) {
+		return -EIO;
+	}
+	memcpy(header, mbr_sector, sizeof(gpt_header_t));
+	if (memcmp(header->signature, GPT_SIGNATURE,
+		   sizeof(header->signature)) != 0) {
+		return -EINVAL;
 	}
-	if (memcmp(header.signature, GPT_SIGNATURE,
-		   sizeof(header.signature)) != 0) {
+
+	if ((header->size < GPT_HEADER_MIN_SIZE) ||
+	    (header->size > PARTITION_BLOCK_SIZE)) {
+		WARN("GPT header size is invalid (%u)\n", header->size);
+		return -EINVAL;
+	}
+
+	/* The header CRC is computed with the CRC field set to zero */
+	memset(&mbr_sector[offsetof(gpt_header_t, header_crc)], 0,
+	       sizeof(header->header_crc));
+	crc = tf_crc32(0U, mbr_sector, header->size);
+	if (crc != header->header_crc) {
+		WARN("GPT header CRC mismatch\n");
+		return -EINVAL;
+	}
+
+	if (header->part_size != sizeof(gpt_entry_t)) {
+		WARN("GPT entry size unsupported (%u)\n", header->part_size);
 		return -EINVAL;
 	}
 
 	/* partition numbers can't exceed PLAT_PARTITION_MAX_ENTRIES */
-	list.entry_count = header.list_num;
+	list.entry_count = header->list_num;
 	if (list.entry_count > PLAT_PARTITION_MAX_ENTRIES) {
 		list.entry_count = PLAT_PARTITION_MAX_ENTRIES;
 	}
 	return 0;
 }
 
-static int load_gpt_entry(uintptr_t image_handle, gpt_entry_t *entry)
+/* FNV-1a hash of a partition name */
+static uint32_t name_hash(const char *name)
 {
-	size_t bytes_read;
-	int result;
+	uint32_t hash = 0x811c9dc5U;
 
-	assert(entry != NULL);
-	result = io_read(image_handle, (uintptr_t)entry, sizeof(gpt_entry_t),
-			 &bytes_read);
-	if (sizeof(gpt_entry_t) != bytes_read)
-		return -EINVAL;
-	return result;
+	while (*name != '\0') {
+		hash ^= (uint8_t)*name++;
+		hash *= 0x01000193U;
+	}
+
+	return hash;
 }
 
-static int verify_partition_gpt(uintptr_t image_handle)
+/* Sort entries by name hash, entries with the same hash in list order */
+static void build_name_index(void)
 {
-	gpt_entry_t entry;
-	int result, i;
+	int i, j;
 
 	for (i = 0; i < list.entry_count; i++) {
-		result = load_gpt_entry(image_handle, &entry);
-		assert(result == 0);
-		result = parse_gpt_entry(&entry, &list.list[i]);
+		uint32_t hash = name_hash(list.list[i].name);
+
+		for (j = i; (j > 0) && (name_index.hash[j - 1] > hash); j--) {
+			name_index.hash[j] = name_index.hash[j - 1];
+			name_index.index[j] = name_index.index[j - 1];
+		}
+		name_index.hash[j] = hash;
+		name_index.index[j] = (uint8_t)i;
+	}
+}
+
+/*
+ * Read the whole GPT entry array, through entry_buf, to check its CRC, and
+ * parse the entries that fit in the partition list.
+ */
+static int verify_partition_gpt(uintptr_t image_handle,
+				const gpt_header_t *header)
+{
+	size_t left = (size_t)header->list_num * header->part_size;
+	size_t offset = header->part_lba * PARTITION_BLOCK_SIZE;
+	size_t chunk, bytes_read;
+	uint32_t crc = 0U;
+	int parsing = 1;
+	int result, i = 0;
+	unsigned int j;
+
+	while (left != 0U) {
+		chunk = MIN(left, sizeof(entry_buf));
+
+		result = io_seek(image_handle, IO_SEEK_SET, offset);
 		if (result != 0) {
-			break;
+			return result;
+		}
+		result = io_read(image_handle, (uintptr_t)entry_buf, chunk,
+				 &bytes_read);
+		if ((result != 0) || (bytes_read != chunk)) {
+			WARN("Failed to read GPT entries (%i)\n", result);
+			return -EIO;
 		}
+
+		crc = tf_crc32(crc, entry_buf, chunk);
+
+		for (j = 0U; parsing && (j < (chunk / sizeof(gpt_entry_t)));
+		     j++) {
+			if (i == list.entry_count) {
+				parsing = 0;
+				break;
+			}
+
+			result = parse_gpt_entry((gpt_entry_t *)entry_buf + j,
+						 &list.list[i]);
+			if (result != 0) {
+				parsing = 0;
+				break;
+			}
+			i++;
+		}
+
+		offset += chunk;
+		left -= chunk;
 	}
+
+	if (crc != header->part_crc) {
+		WARN("GPT entries CRC mismatch\n");
+		return -EINVAL;
+	}
+
 	if (i == 0) {
 		return -EINVAL;
 	}
@@ -139,6 +236,7 @@ static int verify_partition_gpt(uintptr_t image_handle)
 	 */
 	list.entry_count = i;
 	dump_entries(list.entry_count);
+	build_name_index();
 
 	return 0;
 }
@@ -147,6 +245,7 @@ int load_partition_table(unsigned int image_id)
 {
 	uintptr_t dev_handle, image_handle, image_spec = 0;
 	mbr_entry_t mbr_entry;
+	gpt_header_t header;
 	int result;
 
 	result = plat_get_image_source(image_id, &dev_handle, &image_spec);
@@ -168,28 +267,49 @@ int load_partition_table(unsigned int image_id)
 		return result;
 	}
 	if (mbr_entry.type == PARTITION_TYPE_GPT) {
-		result = load_gpt_header(image_handle);
-		assert(result == 0);
-		result = io_seek(image_handle, IO_SEEK_SET, GPT_ENTRY_OFFSET);
-		assert(result == 0);
-		result = verify_partition_gpt(image_handle);
+		result = load_gpt_header(image_handle, &header);
+		if (result != 0) {
+			WARN("Failed to load GPT header (%i)\n", result);
+			goto exit;
+		}
+		result = verify_partition_gpt(image_handle, &header);
 	} else {
 		/* MBR type isn't supported yet. */
 		result = -EINVAL;
 		goto exit;
 	}
 exit:
+	if (result != 0) {
+		list.entry_count = 0;
+	}
 	io_close(image_handle);
 	return result;
 }
 
 const partition_entry_t *get_partition_entry(const char *name)
 {
-	int i;
+	uint32_t hash = name_hash(name);
+	int low = 0;
+	int high = list.entry_count;
 
-	for (i = 0; i < list.entry_count; i++) {
-		if (strcmp(name, list.list[i].name) == 0) {
-			return &list.list[i];
+	/* Find the first index entry with this hash */
+	while (low < high) {
+		int mid = (low + high) / 2;
+
+		if (name_index.hash[mid] < hash) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	for (; (low < list.entry_count) && (name_index.hash[low] == hash);
+	     low++) {
+		const partition_entry_t *entry =
+			&list.list[name_index.index[low]];
+
+		if (strcmp(name, entry->name) == 0) {
+			return entry;
 		}
 	}
 	return NULL;
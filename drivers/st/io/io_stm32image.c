@@ -12,12 +12,20 @@
 #include <io_storage.h>
 #include <platform.h>
 #include <platform_def.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
 #include <utils.h>
 
+/* Loaded payload is checked by slices of this size, while in data cache */
+#define STM32IMAGE_CHECK_SIZE	U(0x4000)
+
+/* Asynchronous transfers size, a chunk is checked while the next one loads */
+#define STM32IMAGE_CHUNK_SIZE	U(0x10000)
+
 static uintptr_t backend_dev_handle;
 static uintptr_t backend_image_spec;
+static uintptr_t backend_handle;
 static uint32_t *stm32_img;
 static uint8_t first_lba_buffer[MAX_LBA_SIZE] __aligned(4);
 static struct stm32image_part_info *current_part;
@@ -88,6 +96,9 @@ static int stm32image_dev_open(const uintptr_t init_params,
 
 	stm32image_dev.device_size = device_info->device_size;
 	stm32image_dev.lba_size = device_info->lba_size;
+	stm32image_dev.byte_access = device_info->byte_access;
+	stm32image_dev.read_start = device_info->read_start;
+	stm32image_dev.read_wait = device_info->read_wait;
 
 	for (i = 0; i < STM32_PART_NUM; i++) {
 		memcpy(stm32image_dev.part_info[i].name,
@@ -141,6 +152,7 @@ static int stm32image_partition_open(io_dev_info_t *dev_info,
 {
 	const struct stm32image_part_info *partition_spec;
 	int idx;
+	int result;
 
 	assert(entity != NULL);
 
@@ -153,6 +165,14 @@ static int stm32image_partition_open(io_dev_info_t *dev_info,
 		return -EINVAL;
 	}
 
+	/* The backend stays open until the partition is closed */
+	result = io_open(backend_dev_handle, backend_image_spec,
+			 &backend_handle);
+	if (result != 0) {
+		ERROR("%s: io_open (%i)\n", __func__, result);
+		return result;
+	}
+
 	current_part = &stm32image_dev.part_info[idx];
 	stm32_img = (uint32_t *)&current_part->part_offset;
 
@@ -162,22 +182,18 @@ static int stm32image_partition_open(io_dev_info_t *dev_info,
 /* Return the size of a partition */
 static int stm32image_partition_size(io_entity_t *entity, size_t *length)
 {
-	int result;
-	uintptr_t backend_handle;
+	int result = 0;
 	size_t bytes_read;
+	size_t header_length = MAX_LBA_SIZE;
 	boot_api_image_header_t *header =
 		(boot_api_image_header_t *)first_lba_buffer;
 
 	assert(entity != NULL);
 	assert(length != NULL);
 
-	/* Attempt to access the image */
-	result = io_open(backend_dev_handle, backend_image_spec,
-			 &backend_handle);
-
-	if (result < 0) {
-		ERROR("%s: io_open (%i)\n", __func__, result);
-		return result;
+	/* Payload will be read separately, straight to its load address */
+	if (stm32image_dev.byte_access) {
+		header_length = sizeof(boot_api_image_header_t);
 	}
 
 	/* Reset magic header value */
@@ -191,7 +207,7 @@ static int stm32image_partition_size(io_entity_t *entity, size_t *length)
 		}
 
 		result = io_read(backend_handle, (uintptr_t)header,
-				 MAX_LBA_SIZE, (size_t *)&bytes_read);
+				 header_length, (size_t *)&bytes_read);
 		if (result != 0) {
 			if (current_part->bkp_offset == 0U) {
 				ERROR("%s: io_read (%i)\n", __func__, result);
@@ -223,8 +239,6 @@ static int stm32image_partition_size(io_entity_t *entity, size_t *length)
 		}
 	}
 
-	io_close(backend_handle);
-
 	if (result != 0) {
 		return result;
 	}
@@ -240,12 +254,176 @@ static int stm32image_partition_size(io_entity_t *entity, size_t *length)
 	return 0;
 }
 
+/* Feed the payload checks with loaded data, STM32IMAGE_CHECK_SIZE at a time */
+static int stm32image_check_payload(uintptr_t buffer, size_t length)
+{
+	size_t slice;
+	int result;
+
+	while (length != 0U) {
+		slice = MIN(length, (size_t)STM32IMAGE_CHECK_SIZE);
+
+		result = stm32mp_check_image_update(buffer, slice);
+		if (result != 0) {
+			return result;
+		}
+
+		buffer += slice;
+		length -= slice;
+	}
+
+	return 0;
+}
+
+/* Load length bytes from offset in a single transfer, then check them */
+static int stm32image_load_sync(uintptr_t buffer, size_t offset, size_t length,
+				size_t *length_read)
+{
+	size_t bytes_read;
+	int result;
+
+	result = io_seek(backend_handle, IO_SEEK_SET, *stm32_img + offset);
+	if (result != 0) {
+		ERROR("%s: io_seek (%i)\n", __func__, result);
+		return result;
+	}
+
+	result = io_read(backend_handle, buffer, length, &bytes_read);
+	if ((result == 0) && (bytes_read != length)) {
+		result = -EIO;
+	}
+
+	if (result != 0) {
+		ERROR("%s: io_read (%i)\n", __func__, result);
+		return result;
+	}
+
+	*length_read += bytes_read;
+
+	return stm32image_check_payload(buffer, bytes_read);
+}
+
+/*
+ * Load length bytes from offset by STM32IMAGE_CHUNK_SIZE transfers. Once a
+ * chunk is in memory, the transfer of the next one is started before the
+ * chunk is checked, so that storage and CPU work in parallel.
+ */
+static int stm32image_load_async(uintptr_t buffer, size_t offset,
+				 size_t length, size_t *length_read)
+{
+	size_t chunk, next;
+	int result;
+
+	chunk = MIN(length, (size_t)STM32IMAGE_CHUNK_SIZE);
+
+	result = stm32image_dev.read_start(*stm32_img + offset, buffer, chunk);
+	if (result != 0) {
+		ERROR("%s: read_start (%i)\n", __func__, result);
+		return result;
+	}
+
+	while (chunk != 0U) {
+		if (stm32image_dev.read_wait() != chunk) {
+			ERROR("%s: read_wait\n", __func__);
+			return -EIO;
+		}
+
+		*length_read += chunk;
+		length -= chunk;
+
+		if (length != 0U) {
+			next = MIN(length, (size_t)STM32IMAGE_CHUNK_SIZE);
+			result = stm32image_dev.read_start(*stm32_img + offset +
+							   chunk,
+							   buffer + chunk,
+							   next);
+			if (result != 0) {
+				ERROR("%s: read_start (%i)\n", __func__,
+				      result);
+				return result;
+			}
+		} else {
+			next = 0U;
+		}
+
+		result = stm32image_check_payload(buffer, chunk);
+		if (result != 0) {
+			if (next != 0U) {
+				(void)stm32image_dev.read_wait();
+			}
+
+			return result;
+		}
+
+		buffer += chunk;
+		offset += chunk;
+		chunk = next;
+	}
+
+	return 0;
+}
+
+/*
+ * Read the image payload to buffer, and feed each part to the payload checks
+ * right after it is loaded.
+ * When the backend can be read at any offset, the payload is transferred
+ * straight from storage. Otherwise, the part that was loaded along with the
+ * header is copied first, and the remaining LBAs are read behind it.
+ */
+static int stm32image_read_payload(uintptr_t buffer, size_t length,
+				   size_t *length_read)
+{
+	uintptr_t local_buffer = buffer;
+	size_t left, offset;
+	int result;
+
+	if (stm32image_dev.byte_access) {
+		offset = sizeof(boot_api_image_header_t);
+		left = length;
+	} else {
+		/* Part of image already loaded with the header */
+		memcpy((uint8_t *)local_buffer, (uint8_t *)first_lba_buffer +
+		       sizeof(boot_api_image_header_t),
+		       MAX_LBA_SIZE - sizeof(boot_api_image_header_t));
+
+		result = stm32mp_check_image_update(local_buffer,
+						    MAX_LBA_SIZE -
+						    sizeof(boot_api_image_header_t));
+		if (result != 0) {
+			return result;
+		}
+
+		local_buffer += MAX_LBA_SIZE - sizeof(boot_api_image_header_t);
+		offset = MAX_LBA_SIZE;
+
+		/* New image length to be read */
+		left = round_up(length -
+				((MAX_LBA_SIZE) -
+				 sizeof(boot_api_image_header_t)),
+				stm32image_dev.lba_size);
+	}
+
+	*length_read = local_buffer - buffer;
+
+	if (left == 0U) {
+		return 0;
+	}
+
+	if ((stm32image_dev.read_start != NULL) &&
+	    (stm32image_dev.read_wait != NULL)) {
+		return stm32image_load_async(local_buffer, offset, left,
+					     length_read);
+	}
+
+	return stm32image_load_sync(local_buffer, offset, left, length_read);
+}
+
 /* Read data from a partition */
 static int stm32image_partition_read(io_entity_t *entity, uintptr_t buffer,
 				     size_t length, size_t *length_read)
 {
 	int result = 0;
-	uint8_t *local_buffer = (uint8_t *)buffer;
+	bool authenticate = false;
 	boot_api_image_header_t *header =
 		(boot_api_image_header_t *)first_lba_buffer;
 
@@ -253,13 +431,15 @@ static int stm32image_partition_read(io_entity_t *entity, uintptr_t buffer,
 	assert(buffer != 0U);
 	assert(length_read != NULL);
 
+#ifdef AUTHENTICATE_BL33
+	authenticate = true;
+#else
+	NOTICE("Authentication disabled: No signature check\n");
+#endif
+
 	*length_read = 0U;
 
 	while (*length_read == 0U) {
-		int offset;
-		int local_length;
-		uintptr_t backend_handle;
-
 		if (header->magic != BOOT_API_IMAGE_HEADER_MAGIC_NB) {
 			/* Check for backup as image is corrupted */
 			if (current_part->bkp_offset == 0U) {
@@ -274,82 +454,42 @@ static int stm32image_partition_read(io_entity_t *entity, uintptr_t buffer,
 				break;
 			}
 
-			local_buffer = (uint8_t *)buffer;
-
 			result = stm32image_partition_size(entity, &length);
 			if (result != 0) {
 				break;
 			}
 		}
 
-		/* Part of image already loaded with the header */
-		memcpy(local_buffer, (uint8_t *)first_lba_buffer +
-		       sizeof(boot_api_image_header_t),
-		       MAX_LBA_SIZE - sizeof(boot_api_image_header_t));
-		local_buffer += MAX_LBA_SIZE - sizeof(boot_api_image_header_t);
-		offset = MAX_LBA_SIZE;
-
-		/* New image length to be read */
-		local_length = round_up(length -
-					((MAX_LBA_SIZE) -
-					 sizeof(boot_api_image_header_t)),
-					stm32image_dev.lba_size);
-
 		if ((header->load_address != 0U) &&
 		    (header->load_address != buffer)) {
 			ERROR("Wrong load address\n");
 			panic();
 		}
 
-		result = io_open(backend_dev_handle, backend_image_spec,
-				 &backend_handle);
-
-		if (result != 0) {
-			ERROR("%s: io_open (%i)\n", __func__, result);
-			break;
+		result = stm32mp_check_image_start(header, authenticate,
+						   current_part->binary_type,
+						   current_part->part_offset);
+		if (result == 0) {
+			result = stm32image_read_payload(buffer, length,
+							 length_read);
 		}
 
-		result = io_seek(backend_handle, IO_SEEK_SET,
-				 *stm32_img + offset);
-
-		if (result != 0) {
-			ERROR("%s: io_seek (%i)\n", __func__, result);
-			*length_read = 0;
-			io_close(backend_handle);
-			break;
+		if (result == 0) {
+			result = stm32mp_check_image_checksum();
 		}
 
-		result = io_read(backend_handle, (uintptr_t)local_buffer,
-				 local_length, length_read);
-
-		/* Adding part of size already read from header */
-		*length_read += MAX_LBA_SIZE - sizeof(boot_api_image_header_t);
-
-		if (result != 0) {
-			ERROR("%s: io_read (%i)\n", __func__, result);
-			*length_read = 0;
-			header->magic = 0;
-			continue;
-		}
-
-		result = check_header(header, buffer);
 		if (result != 0) {
 			ERROR("Header check failed\n");
 			*length_read = 0;
 			header->magic = 0;
+			continue;
 		}
 
-#ifdef AUTHENTICATE_BL33
-		result = check_authentication(header, buffer);
+		result = stm32mp_check_image_signature();
 		if (result != 0) {
 			ERROR("Authentication Failed\n");
 			return result;
 		}
-#else
-		NOTICE("Authentication disabled: No signature check\n");
-#endif
-
-		io_close(backend_handle);
 	}
 
 	return result;
@@ -360,6 +500,9 @@ static int stm32image_partition_close(io_entity_t *entity)
 {
 	current_part = NULL;
 
+	io_close(backend_handle);
+	backend_handle = 0U;
+
 	return 0;
 }
 
@@ -129,6 +129,7 @@ static int stm32_sdmmc2_send_cmd(struct mmc_cmd *cmd);
 static int stm32_sdmmc2_set_ios(unsigned int clk, unsigned int width);
 static int stm32_sdmmc2_prepare(int lba, uintptr_t buf, size_t size);
 static int stm32_sdmmc2_read(int lba, uintptr_t buf, size_t size);
+static int stm32_sdmmc2_read_poll(int lba, uintptr_t buf, size_t size);
 static int stm32_sdmmc2_write(int lba, uintptr_t buf, size_t size);
 
 static const struct mmc_ops stm32_sdmmc2_ops = {
@@ -137,6 +138,7 @@ static const struct mmc_ops stm32_sdmmc2_ops = {
 	.set_ios	= stm32_sdmmc2_set_ios,
 	.prepare	= stm32_sdmmc2_prepare,
 	.read		= stm32_sdmmc2_read,
+	.read_poll	= stm32_sdmmc2_read_poll,
 	.write		= stm32_sdmmc2_write,
 };
 
@@ -293,14 +295,8 @@ static int stm32_sdmmc2_send_cmd_req(struct mmc_cmd *cmd)
 		break;
 	case MMC_CMD(17):
 	case MMC_CMD(18):
+		/* IDMA completion is checked by stm32_sdmmc2_read[_poll]() */
 		cmd_reg |= SDMMC_CMDR_CMDTRANS;
-		if (sdmmc2_params.use_dma) {
-			flags_data |= SDMMC_STAR_DCRCFAIL |
-				      SDMMC_STAR_DTIMEOUT |
-				      SDMMC_STAR_DATAEND |
-				      SDMMC_STAR_RXOVERR |
-				      SDMMC_STAR_IDMATE;
-		}
 		break;
 	case MMC_ACMD(41):
 		arg_reg |= OCR_3_2_3_3 | OCR_3_3_3_4;
@@ -392,7 +388,12 @@ static int stm32_sdmmc2_send_cmd_req(struct mmc_cmd *cmd)
 	}
 
 	if (flags_data == 0U) {
-		mmio_write_32(base + SDMMC_ICR, SDMMC_STATIC_FLAGS);
+		/* Keep data flags of a transfer that may already be over */
+		if ((cmd_reg & SDMMC_CMDR_CMDTRANS) != 0U) {
+			mmio_write_32(base + SDMMC_ICR, flags_cmd);
+		} else {
+			mmio_write_32(base + SDMMC_ICR, SDMMC_STATIC_FLAGS);
+		}
 
 		return 0;
 	}
@@ -578,6 +579,75 @@ static int stm32_sdmmc2_prepare(int lba, uintptr_t buf, size_t size)
 	return 0;
 }
 
+/*
+ * Check whether the IDMA transfer of a read is over. Return -EBUSY while it
+ * is still in flight, else release the data path and return its status.
+ */
+static int stm32_sdmmc2_dma_complete(uintptr_t buf, size_t size)
+{
+	uint32_t error_flags = SDMMC_STAR_DCRCFAIL | SDMMC_STAR_DTIMEOUT |
+			       SDMMC_STAR_RXOVERR | SDMMC_STAR_IDMATE;
+	uintptr_t base = sdmmc2_params.reg_base;
+	uint32_t status;
+	int ret;
+
+	status = mmio_read_32(base + SDMMC_STAR);
+
+	if ((status & (error_flags | SDMMC_STAR_DATAEND)) == 0U) {
+		return -EBUSY;
+	}
+
+	mmio_write_32(base + SDMMC_ICR, SDMMC_STATIC_FLAGS);
+	mmio_clrbits_32(base + SDMMC_CMDR, SDMMC_CMDR_CMDTRANS);
+
+	if ((status & error_flags) != 0U) {
+		ERROR("%s: DMA read error (status = %x)\n", __func__, status);
+		dump_registers();
+
+		if ((status & SDMMC_STAR_DPSMACT) != 0U) {
+			ret = stm32_sdmmc2_stop_transfer();
+			if (ret != 0) {
+				return ret;
+			}
+		}
+
+		return -EIO;
+	}
+
+	inv_dcache_range(buf, size);
+
+	return 0;
+}
+
+static int stm32_sdmmc2_dma_wait(uintptr_t buf, size_t size)
+{
+	uintptr_t base = sdmmc2_params.reg_base;
+	uint64_t start;
+	int ret;
+
+	start = timeout_start();
+
+	while ((ret = stm32_sdmmc2_dma_complete(buf, size)) == -EBUSY) {
+		if (timeout_elapsed(start, TIMEOUT_1_S)) {
+			ERROR("%s: timeout 1s (status = %x)\n", __func__,
+			      mmio_read_32(base + SDMMC_STAR));
+			dump_registers();
+			mmio_write_32(base + SDMMC_ICR, SDMMC_STATIC_FLAGS);
+			mmio_clrbits_32(base + SDMMC_CMDR,
+					SDMMC_CMDR_CMDTRANS);
+
+			ret = stm32_sdmmc2_stop_transfer();
+			if (ret != 0) {
+				return ret;
+			}
+
+			return -ETIMEDOUT;
+		}
+	}
+
+	return ret;
+}
+
 static int stm32_sdmmc2_read(int lba, uintptr_t buf, size_t size)
 {
 	uint32_t error_flags = SDMMC_STAR_RXOVERR | SDMMC_STAR_DCRCFAIL |
@@ -596,9 +666,7 @@ static int stm32_sdmmc2_read(int lba, uintptr_t buf, size_t size)
 	buffer = (uint32_t *)buf;
 
 	if (sdmmc2_params.use_dma) {
-		inv_dcache_range(buf, size);
-
-		return 0;
+		return stm32_sdmmc2_dma_wait(buf, size);
 	}
 
 	if (size <= MMC_BLOCK_SIZE) {
@@ -670,6 +738,16 @@ static int stm32_sdmmc2_read(int lba, uintptr_t buf, size_t size)
 	return 0;
 }
 
+static int stm32_sdmmc2_read_poll(int lba, uintptr_t buf, size_t size)
+{
+	/* Without IDMA, data has to be drained from the FIFO by the CPU */
+	if (!sdmmc2_params.use_dma) {
+		return stm32_sdmmc2_read(lba, buf, size);
+	}
+
+	return stm32_sdmmc2_dma_complete(buf, size);
+}
+
 static int stm32_sdmmc2_write(int lba, uintptr_t buf, size_t size)
 {
 	return 0;
@@ -10,6 +10,7 @@
 #include <io_nand.h>
 #include <io_storage.h>
 #include <nand.h>
+#include <stdbool.h>
 #include <string.h>
 #include <utils_def.h>
 
@@ -29,6 +30,24 @@ static io_type_t device_type_nand(void);
 static NAND_HandleTypeDef *hnand;
 static uint64_t seek_offset;
 
+/*
+ * Partitions are written skipping bad blocks from their first block, so
+ * their logical blocks map to the good blocks that follow their first
+ * physical block. The device is opened once per partition, and the first
+ * block read after the open is taken as the partition start: any later
+ * block, whatever the seeks in between, is mapped from it. The cursor is the
+ * last block mapped, so that sequential reads only check the next block.
+ */
+typedef struct {
+	bool valid;
+	uint32_t start_lblock;
+	uint32_t start_pblock;
+	uint32_t cur_lblock;
+	uint32_t cur_pblock;
+} nand_stream_t;
+
+static nand_stream_t stream;
+
 static const io_dev_connector_t nand_dev_connector = {
 	.dev_open = nand_dev_open
 };
@@ -90,8 +109,11 @@ static int nand_dev_open(const uintptr_t init_params, io_dev_info_t **dev_info)
 	return 0;
 }
 
+/* Build the bad block table, once, before images are read */
 static int nand_dev_init(io_dev_info_t *dev_info, const uintptr_t init_params)
 {
+	NAND_Init_Bad_Block_Table(hnand);
+
 	return 0;
 }
 
@@ -106,6 +128,7 @@ static int nand_block_open(io_dev_info_t *dev_info, const  uintptr_t spec,
 			   io_entity_t *entity)
 {
 	seek_offset = 0;
+	stream.valid = false;
 	return 0;
 }
 
@@ -117,90 +140,141 @@ static int nand_block_seek(io_entity_t *entity, int mode,
 	return 0;
 }
 
+/* Return the first good block from block, or BlockNb if there is none */
+static uint32_t nand_next_good_block(uint32_t block)
+{
+	while ((block < hnand->Info.BlockNb) &&
+	       (NAND_Get_Block_Status(hnand, block) == BAD_BLOCK))
+		block++;
+
+	return block;
+}
+
+/* Return the physical block holding logical block lblock of the partition */
+static uint32_t nand_stream_map(uint32_t lblock)
+{
+	uint32_t pblock;
+
+	/* A read before the partition start begins a new mapping */
+	if (!stream.valid || (lblock < stream.start_lblock)) {
+		stream.valid = true;
+		stream.start_lblock = lblock;
+		stream.start_pblock = nand_next_good_block(lblock);
+		stream.cur_lblock = lblock;
+		stream.cur_pblock = stream.start_pblock;
+	}
+
+	if (lblock < stream.cur_lblock) {
+		stream.cur_lblock = stream.start_lblock;
+		stream.cur_pblock = stream.start_pblock;
+	}
+
+	pblock = stream.cur_pblock;
+	while ((stream.cur_lblock < lblock) &&
+	       (pblock < hnand->Info.BlockNb)) {
+		pblock = nand_next_good_block(pblock + 1U);
+		stream.cur_lblock++;
+	}
+
+	stream.cur_pblock = pblock;
+
+	return pblock;
+}
+
 /* Read data from a file on the nand device */
 static int nand_block_read(io_entity_t *entity, uintptr_t buffer,
 			   size_t length, size_t *length_read)
 {
 	uint32_t block_size_shift = hnand->Info.block_size_shift;
 	uint32_t page_size_shift = hnand->Info.page_size_shift;
-	uint32_t buffer_index = 0;
-	uint32_t num_sectors_read = seek_offset / BCH_PAGE_SECTOR;
-	uint64_t number_sectors_to_read = length / BCH_PAGE_SECTOR;
-	uint64_t nand_address_block, nand_address_page;
+	uint32_t sectors_per_page = hnand->Info.PageSize / BCH_PAGE_SECTOR;
+	uint32_t lblock = (uint32_t)(seek_offset >> block_size_shift);
+	uint32_t num_sectors_read = 0U;
+	uint64_t number_sectors_to_read = div_round_up(length,
+						       BCH_PAGE_SECTOR);
+	uint32_t bch_sector_nb;
+	uint32_t pblock;
 	NAND_AddressTypeDef nand_address;
 
 	*length_read = 0;
 
-	nand_address_block = seek_offset;
-	while (block_size_shift) {
-		nand_address_block >>= 1;
-		if (!nand_address_block)
-			break;
-		block_size_shift--;
-	}
-
-	nand_address.Block = (uint16_t)nand_address_block;
-
-	nand_address_page = seek_offset & ((1 << hnand->Info.block_size_shift)
-					   - 1);
-	while (page_size_shift) {
-		nand_address_page >>= 1;
-		if (!nand_address_page)
-			break;
-		page_size_shift--;
-	}
-
-	nand_address.Page = (uint16_t)nand_address_page;
-
-	while (NAND_Check_Bad_Block(hnand, &nand_address) == BAD_BLOCK) {
-		nand_address.Block++;
-		if (nand_address.Block >= hnand->Info.BlockNb) {
-			ERROR("Cannot find valid block\n");
-			return -EIO;
-		}
+	pblock = nand_stream_map(lblock);
+	if (pblock >= hnand->Info.BlockNb) {
+		ERROR("Cannot find valid block\n");
+		return -EIO;
 	}
 
-	if ((length % BCH_PAGE_SECTOR) != 0) {
-		/*
-		 * yes, remainder required,
-		 * adjust total number of sectors required
-		 * one more page needed to read,
-		 * data will not fill all page
-		 */
-		number_sectors_to_read += 1;
-	}
+	nand_address.Block = (uint16_t)pblock;
+	nand_address.Page = (uint16_t)((seek_offset &
+					((1ULL << block_size_shift) - 1U)) >>
+				       page_size_shift);
+	bch_sector_nb = (uint32_t)(seek_offset / BCH_PAGE_SECTOR) %
+			sectors_per_page;
 
 	/*
 	 * Proceed here with reading/copying of
 	 * (number_of_pages_remaining_to_read * BCH_PAGE_SECTOR)
-	 * from NAND memory to SYSRAM download area
+	 * from NAND memory to SYSRAM download area.
+	 * Whole pages are read with a single command each, sectors are only
+	 * read one by one at the start and end of an unaligned area.
 	 */
-	while (number_sectors_to_read != 0) {
-		uint32_t bch_sector_nb = num_sectors_read %
-			(hnand->Info.PageSize / BCH_PAGE_SECTOR);
-
-		if (NAND_Read_Logical_Page(hnand, &nand_address,
-					   (uint8_t *)(buffer +
-						       (buffer_index *
-							BCH_PAGE_SECTOR)),
-					   bch_sector_nb) != STD_OK) {
-			VERBOSE("Page read failed or end of NAND reached\n");
-			return -EIO;
+	while (number_sectors_to_read != 0U) {
+		uint8_t *dest = (uint8_t *)(buffer +
+					    (num_sectors_read *
+					     BCH_PAGE_SECTOR));
+		uint32_t nb_sectors;
+
+		if ((bch_sector_nb == 0U) &&
+		    (number_sectors_to_read >= sectors_per_page)) {
+			uint32_t nb_pages = hnand->Info.BlockSize -
+					    nand_address.Page;
+
+			if (nb_pages > (number_sectors_to_read /
+					sectors_per_page))
+				nb_pages = number_sectors_to_read /
+					   sectors_per_page;
+
+			if (NAND_Read_Pages(hnand, &nand_address, dest,
+					    nb_pages) != STD_OK) {
+				VERBOSE("Page read failed\n");
+				return -EIO;
+			}
+
+			nb_sectors = nb_pages * sectors_per_page;
+			nand_address.Page += nb_pages;
+		} else {
+			if (NAND_Read_Logical_Page(hnand, &nand_address, dest,
+						   bch_sector_nb) != STD_OK) {
+				VERBOSE("Page read failed\n");
+				return -EIO;
+			}
+
+			nb_sectors = 1U;
+			if (++bch_sector_nb == sectors_per_page) {
+				bch_sector_nb = 0U;
+				nand_address.Page++;
+			}
 		}
 
-		/* Increment read sectors number */
-		num_sectors_read++;
-		buffer_index++;
+		num_sectors_read += nb_sectors;
+		number_sectors_to_read -= nb_sectors;
+
+		if ((nand_address.Page < hnand->Info.BlockSize) ||
+		    (number_sectors_to_read == 0U))
+			continue;
 
-		/* Decrement sectors to read */
-		number_sectors_to_read--;
+		/* Next logical block is the next good block */
+		nand_address.Page = 0U;
+		pblock = nand_stream_map(++lblock);
+		if (pblock >= hnand->Info.BlockNb) {
+			VERBOSE("End of NAND reached\n");
+			return -EIO;
+		}
 
-		/* Increment the NAND address */
-		NAND_Address_Inc(hnand, &nand_address, num_sectors_read);
+		nand_address.Block = (uint16_t)pblock;
 	}
 
-	*length_read = ((num_sectors_read - (seek_offset / BCH_PAGE_SECTOR)) *
-			BCH_PAGE_SECTOR);
+	*length_read = num_sectors_read * BCH_PAGE_SECTOR;
 
 	return 0;
 }
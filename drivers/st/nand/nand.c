@@ -22,9 +22,13 @@
 #include <nand.h>
 #include <platform.h>
 #include <platform_def.h>
+#include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 #include <utils_def.h>
 
+#include "nand_hamming.h"
+
 /* Other internal NAND driver definitions */
 #define CMD_SECTION             ((uint32_t)(1 << 16))  /* A16 high */
 #define ADDR_SECTION            ((uint32_t)(1 << 17))  /* A17 high */
@@ -56,6 +60,7 @@
 #define NAND_ECC_BCH4_BYTES_NB_16b     8
 #define NAND_ECC_BCH8_BYTES_NB_16b    14
 #define PARAM_PAGE_SIZE          256
+#define NAND_OPT_CMD_READ_CACHE  BIT(1)
 
 /* NAND memory status */
 #define NAND_BUSY                  ((uint32_t)0x00000000U)
@@ -69,6 +74,8 @@
 #define NAND_CMD_READ_PARAM_PAGE         ((uint8_t)0xECU)
 #define NAND_CMD_READ_1ST                ((uint8_t)0x00U)
 #define NAND_CMD_READ_2ND                ((uint8_t)0x30U)
+#define NAND_CMD_READ_CACHE_SEQ          ((uint8_t)0x31U)
+#define NAND_CMD_READ_CACHE_END          ((uint8_t)0x3FU)
 #define NAND_CMD_STATUS                  ((uint8_t)0x70U)
 #define NAND_CMD_CHANGE_1ST              ((uint8_t)0x05U)
 #define NAND_CMD_CHANGE_2ND              ((uint8_t)0xE0U)
@@ -77,6 +84,31 @@
 #define CRC_POLYNOM      0x8005
 #define CRC_INIT_VALUE   0x4F4E
 
+/*
+ * Linux on-flash bad block table, as written by the FMC2 driver: it is in the
+ * data area of one of the last blocks (NAND_BBT_NO_OOB), starting with a
+ * pattern and a version byte, followed by 2 bits per block.
+ */
+#define NAND_BBT_SCAN_MAXBLOCKS	4U
+#define NAND_BBT_PATTERN_LEN	4U
+#define NAND_BBT_VERSION_OFFSET	NAND_BBT_PATTERN_LEN
+#define NAND_BBT_DATA_OFFSET	(NAND_BBT_VERSION_OFFSET + 1U)
+#define NAND_BBT_ENTRY_BITS	2U
+#define NAND_BBT_ENTRY_GOOD	0x3U
+
+static const uint8_t bbt_main_pattern[NAND_BBT_PATTERN_LEN] = {
+	'B', 'b', 't', '0'
+};
+static const uint8_t bbt_mirror_pattern[NAND_BBT_PATTERN_LEN] = {
+	'1', 't', 'b', 'B'
+};
+
+/* Bad block table, a block is checked on flash until it is known */
+static uint8_t bbt_known[NAND_BBT_MAX_BLOCKS / 8];
+static uint8_t bbt_bad[NAND_BBT_MAX_BLOCKS / 8];
+static uint8_t bbt_sector[BCH_PAGE_SECTOR] __aligned(4);
+static bool bbt_initialized;
+
 static void nand_calc_timing(NAND_HandleTypeDef *hNand)
 {
 	nand_timings *tims = &hNand->Info.timings;
@@ -526,7 +558,7 @@ static uint16_t NAND_CheckCrc16(uint16_t crc, uint8_t *data_in,
 
 /*****************************************************************************
  *
- * Function:          Nand_ReadParameterPage
+ * Function:          Nand_GetParameterPage
  *
  * Description:       This function reads the NAND parameter page
  *                    (command 0xEC)
@@ -539,15 +571,15 @@ static uint16_t NAND_CheckCrc16(uint16_t crc, uint8_t *data_in,
  *
  * Input parameters:  NAND_HandleTypeDef * hNand
  *
- * Output parameters: none
+ * Output parameters: buffer: first valid copy of the parameter page
  *
  * Return:            Std_ReturnType
  *
  *****************************************************************************/
-static Std_ReturnType Nand_ReadParameterPage(NAND_HandleTypeDef *hNand)
+static Std_ReturnType Nand_GetParameterPage(NAND_HandleTypeDef *hNand,
+					    uint8_t *buffer)
 {
 	uint32_t index;
-	uint8_t  buffer[PARAM_PAGE_SIZE];
 	uintptr_t deviceComMemAddr;
 	uintptr_t deviceAttrMemAddr;
 	int      i;
@@ -590,15 +622,51 @@ static Std_ReturnType Nand_ReadParameterPage(NAND_HandleTypeDef *hNand)
 		if ((hNand->Info.Signature == ONFI_SIG_VALUE) &&
 		    (NAND_CheckCrc16(CRC_INIT_VALUE, buffer,
 				     PARAM_PAGE_SIZE - 2) == crc16))
-			break;
+			return STD_OK;
 	}
 
-	if (i == 3) {
+	return STD_NOT_OK;
+}
+
+/*****************************************************************************
+ *
+ * Function:          Nand_ReadParameterPage
+ *
+ * Description:       This function reads the ONFI parameter page.
+ *                    Geometry, bus width, ECC requirements and optional
+ *                    commands are retrieved from it.
+ *
+ * Input parameters:  NAND_HandleTypeDef * hNand
+ *
+ * Output parameters: none
+ *
+ * Return:            Std_ReturnType
+ *
+ *****************************************************************************/
+static Std_ReturnType Nand_ReadParameterPage(NAND_HandleTypeDef *hNand)
+{
+	uint32_t index;
+	uint8_t  buffer[PARAM_PAGE_SIZE];
+	uintptr_t deviceComMemAddr;
+	uintptr_t deviceAttrMemAddr;
+	int      i;
+	uint16_t crc16;
+
+	assert(hNand);
+
+	/* Identify the device address */
+	deviceComMemAddr = FLASH_COMMON_MEM_BASE;
+	deviceAttrMemAddr = FLASH_ATTRIB_MEM_BASE;
+
+	if (Nand_GetParameterPage(hNand, buffer) != STD_OK) {
 		/* Could not find ONFI parameter page */
 		INFO("%s: No Onfi Parameter Page\n", __func__);
 		return STD_NOT_OK;
 	}
 
+	/* Bytes 8-9 (optional commands), bit 1: read cache supported */
+	hNand->Info.read_cache = (buffer[8] & NAND_OPT_CMD_READ_CACHE) != 0U;
+
 	/* Byte 6, bit 0: data bus width (8 or 16) */
 	hNand->Info.BusWidth = buffer[6] & 0x1;
 
@@ -968,28 +1036,6 @@ static void NAND_Read_Page_Cmd(NAND_HandleTypeDef *hNand, uint32_t colAddr,
 	}
 }
 
-/*****************************************************************************
- *
- * Function:            _bit_count
- *
- * Description:         Return the number of bits set to one in a 32bit word
- *
- * Input parameters:    v    32 bit word
- *
- * Return:              number of bits set to one in v.
- *
- *****************************************************************************/
-static uint32_t _bit_count(uint32_t v)
-{
-	uint32_t c = 0;
-
-	for (uint32_t i = 0; i < CHAR_BIT * sizeof(typeof(v)); i++)
-		if (v & (BIT(i)))
-			c++;
-
-	return c;
-}
-
 /*****************************************************************************
  *
  * Function:            NAND_Hamming_Correction
@@ -1012,12 +1058,7 @@ static uint32_t _bit_count(uint32_t v)
 static int NAND_Hamming_Correction(uint8_t *Buffer, uint8_t *EccBuffer,
 				   uint32_t EccCalculated)
 {
-	uint8_t xor_ecc_ones;
-	uint16_t xor_ecc_1b, xor_ecc_2b, xor_ecc_3b;
-	union {
-		uint32_t val;
-		uint8_t  bytes[4];
-	} xor_ecc;
+	uint32_t xor_ecc, xor_ecc_ones, address;
 
 	/* Page size--------ECC_Code Size
 	 * 256---------------22 bits LSB  (ECC_CODE & 0x003FFFFF)
@@ -1029,45 +1070,31 @@ static int NAND_Hamming_Correction(uint8_t *Buffer, uint8_t *EccBuffer,
 	 */
 
 	/* For Page size 512, ECC_Code size 24 bits */
-	xor_ecc_1b = (EccCalculated & 0x000000FF) ^ EccBuffer[0];
-	xor_ecc_2b = ((EccCalculated & 0x0000FF00) >> 8) ^ EccBuffer[1];
-	xor_ecc_3b = ((EccCalculated & 0x00FF0000) >> 16) ^ EccBuffer[2];
-
-	xor_ecc.val = 0L;
-	xor_ecc.bytes[2] = xor_ecc_3b;
-	xor_ecc.bytes[1] = xor_ecc_2b;
-	xor_ecc.bytes[0] = xor_ecc_1b;
+	xor_ecc = (EccCalculated & NAND_HAMMING_SYNDROME_MASK) ^
+		  ((uint32_t)EccBuffer[0] | ((uint32_t)EccBuffer[1] << 8) |
+		   ((uint32_t)EccBuffer[2] << 16));
 
-	if (xor_ecc.val == 0)
+	if (xor_ecc == 0)
 		return 0; /* No Error */
 
-	xor_ecc_ones = _bit_count(xor_ecc.val);
-	if (xor_ecc_ones < 23) {
-		if (xor_ecc_ones == 12) {
-			uint16_t bit_address, byte_address;
-
-			/* Correctable ERROR */
-			bit_address = ((xor_ecc_1b >> 1) & 0x01) |
-				      ((xor_ecc_1b >> 2) & 0x02) |
-				      ((xor_ecc_1b >> 3) & 0x04);
-
-			byte_address = ((xor_ecc_1b >> 7) & 0x01) |
-				       ((xor_ecc_2b)      & 0x02) |
-				       ((xor_ecc_2b >> 1) & 0x04) |
-				       ((xor_ecc_2b >> 2) & 0x08) |
-				       ((xor_ecc_2b >> 3) & 0x10) |
-				       ((xor_ecc_3b << 4) & 0x20) |
-				       ((xor_ecc_3b << 3) & 0x40) |
-				       ((xor_ecc_3b << 2) & 0x80) |
-				       ((xor_ecc_3b << 1) & 0x100);
-
-			/* Correct bit error in the data */
-			Buffer[byte_address] = (Buffer[byte_address]) ^
-				((uint8_t)(1 << bit_address));
-			INFO("Hamming: 1 ECC error corrected\n");
-			return 1;
-		}
+	if (nand_hamming_data_error(xor_ecc)) {
+		/* Correctable ERROR */
+		address = nand_hamming_error_address(xor_ecc);
 
+		/* Correct bit error in the data */
+		Buffer[address >> 3] ^= (uint8_t)BIT(address & 0x7);
+		INFO("Hamming: 1 ECC error corrected\n");
+		return 1;
+	}
+
+	xor_ecc_ones = nand_hamming_bit_count(xor_ecc);
+	if (xor_ecc_ones == 1) {
+		/* Single bit error in the ECC code itself, data is correct */
+		INFO("Hamming: 1 ECC error in ECC code\n");
+		return 1;
+	}
+
+	if (xor_ecc_ones < 23) {
 		/* Non Correctable ERROR */
 		ERROR("%s: Uncorrectable ECC Errors\n", __func__);
 		return 2;
@@ -1080,45 +1107,332 @@ static int NAND_Hamming_Correction(uint8_t *Buffer, uint8_t *EccBuffer,
 
 /*****************************************************************************
  *
- * Function:            NAND_Read_Logical_Page
+ * Function:            NAND_Send_Cmd
  *
- * Description:         Read 512B sector from NAND memory page
+ * Description:         Send a command without address cycles
+ *
+ * Input parameters:    hNand: pointer to a NAND_HandleTypeDef structure
+ *                      that contains the configuration information
+ *                      for NAND module.
+ *                      cmd : command
+ *
+ * Return:              None
+ *
+ *****************************************************************************/
+static void NAND_Send_Cmd(NAND_HandleTypeDef *hNand, uint8_t cmd)
+{
+	uintptr_t deviceAttrMemAddr = FLASH_ATTRIB_MEM_BASE;
+
+	if (hNand->Info.BusWidth == EIGHT_BIT_ACCESS)
+		*(__IO uint8_t *)(deviceAttrMemAddr | CMD_SECTION) = cmd;
+	else
+		*(__IO uint16_t *)(deviceAttrMemAddr | CMD_SECTION) = cmd;
+}
+
+/*****************************************************************************
+ *
+ * Function:            NAND_Change_Read_Column
+ *
+ * Description:         Move the data output to another column of the page
+ *                      already loaded in the page register
+ *
+ * Input parameters:    hNand: pointer to a NAND_HandleTypeDef structure
+ *                      that contains the configuration information
+ *                      for NAND module.
+ *                      colAddr : column address
+ *
+ * Return:              None
+ *
+ *****************************************************************************/
+static void NAND_Change_Read_Column(NAND_HandleTypeDef *hNand,
+				    uint32_t colAddr)
+{
+	uintptr_t deviceComMemAddr = FLASH_COMMON_MEM_BASE;
+	uintptr_t deviceAttrMemAddr = FLASH_ATTRIB_MEM_BASE;
+
+	if (hNand->Info.BusWidth == EIGHT_BIT_ACCESS) {
+		*(__IO uint8_t *)(deviceComMemAddr | CMD_SECTION) =
+			NAND_CMD_CHANGE_1ST;
+
+		/* C1 */
+		*(__IO uint8_t *)(deviceComMemAddr | ADDR_SECTION) =
+			ADDR_1ST_CYCLE(colAddr);
+		/* C2 */
+		*(__IO uint8_t *)(deviceAttrMemAddr | ADDR_SECTION) =
+			ADDR_2ND_CYCLE(colAddr);
+
+		*(__IO uint8_t *)(deviceAttrMemAddr | CMD_SECTION) =
+			NAND_CMD_CHANGE_2ND;
+	} else {
+		*(__IO uint16_t *)(deviceComMemAddr | CMD_SECTION) =
+			NAND_CMD_CHANGE_1ST;
+
+		/* C1 */
+		*(__IO uint16_t *)(deviceComMemAddr | ADDR_SECTION) =
+			ADDR_1ST_CYCLE(colAddr);
+		/* C2 */
+		*(__IO uint16_t *)(deviceAttrMemAddr | ADDR_SECTION) =
+			ADDR_2ND_CYCLE(colAddr);
+
+		*(__IO uint16_t *)(deviceAttrMemAddr | CMD_SECTION) =
+			NAND_CMD_CHANGE_2ND;
+	}
+}
+
+/*****************************************************************************
+ *
+ * Function:            NAND_Hamming_Syndrome
+ *
+ * Description:         Get the Hamming code calculated by FMC during reading
+ *                      of data.
+ *
+ * Input parameters:    hNand: pointer to a NAND_HandleTypeDef structure
+ *                      that contains the configuration information
+ *                      for NAND module.
+ *                      ecc : calculated ECC code
+ *
+ * Return:              Std_ReturnType
+ *
+ *****************************************************************************/
+static Std_ReturnType NAND_Hamming_Syndrome(NAND_HandleTypeDef *hNand,
+					    uint32_t *ecc)
+{
+	/* During read of data , syndrome is calculated */
+	/* Wait until decoding error is ready */
+	uint32_t timerValInit = read_cntpct_el0();
+
+	while ((hNand->Instance->SR & FMC_SR_NWRF) != FMC_SR_NWRF) {
+		if ((read_cntpct_el0() - timerValInit) >
+		    NAND_ECC_CALCULATION_TIMEOUT_VAL_250MS) {
+			ERROR("%s: syndrome calculation timeout\n", __func__);
+			return STD_NOT_OK;
+		}
+	}
+
+	*ecc = hNand->Instance->HECCR;
+
+	return STD_OK;
+}
+
+/*****************************************************************************
+ *
+ * Function:            NAND_Hamming_Correct
+ *
+ * Description:         Hamming ECC engine correction
+ *
+ * Input parameters:    hNand: pointer to a NAND_HandleTypeDef structure
+ *                      that contains the configuration information
+ *                      for NAND module.
+ *                      Buffer : pointer to buffer containing data read.
+ *                      EccBuffer : pointer to buffer containing ecc code read
+ *                                  from out of band area.
+ *                      ecc : ECC calculated by FMC during reading of data.
+ *
+ * Return:              Std_ReturnType
+ *
+ *****************************************************************************/
+static Std_ReturnType NAND_Hamming_Correct(NAND_HandleTypeDef *hNand,
+					   uint8_t *Buffer, uint8_t *EccBuffer,
+					   uint32_t ecc)
+{
+	int nb_errors;
+
+	nb_errors = NAND_Hamming_Correction(Buffer, EccBuffer, ecc);
+	if ((nb_errors != 0) && (nb_errors != 1))
+		return STD_NOT_OK;
+
+	return STD_OK;
+}
+
+/*****************************************************************************
+ *
+ * Function:            NAND_BCH_Correct
+ *
+ * Description:         BCH ECC engine correction, from the error positions
+ *                      found by the FMC BCH decoder.
+ *
+ * Input parameters:    hNand: pointer to a NAND_HandleTypeDef structure
+ *                      that contains the configuration information
+ *                      for NAND module.
+ *                      Buffer : pointer to buffer containing data read.
+ *                      EccBuffer : unused, FMC decodes ECC bytes as they are
+ *                                  read.
+ *                      ecc : unused.
+ *
+ * Return:              Std_ReturnType
+ *
+ *****************************************************************************/
+static Std_ReturnType NAND_BCH_Correct(NAND_HandleTypeDef *hNand,
+				       uint8_t *Buffer, uint8_t *EccBuffer,
+				       uint32_t ecc)
+{
+	uint32_t ecc_errors_nb;
+	uint32_t i;
+	uint32_t errorPosition[NAND_ECC_BCH8];
+
+	/*
+	 * During read of data and parity bits, syndrome is calculated,
+	 * then error location is launched
+	 * Wait until decoding error is ready
+	 */
+	uint32_t timerValInit = (uint32_t)read_cntpct_el0();
+
+	while ((hNand->Instance->BCHISR & FMC_BCHISR_DERF) !=
+	       FMC_BCHISR_DERF) {
+		if (((uint32_t)read_cntpct_el0() - timerValInit) >
+		    NAND_ECC_CALCULATION_TIMEOUT_VAL_250MS)
+			return STD_NOT_OK;
+	}
+
+	/* Read decoding results */
+	/* Check if there were uncorrectable errors */
+	if (hNand->Instance->BCHISR & FMC_BCHISR_DUEF) {
+		VERBOSE("%s: Uncorrectable ECC Error\n", __func__);
+		return STD_NOT_OK;
+	}
+
+	/* Check if there were errors */
+	if (!(hNand->Instance->BCHISR & FMC_BCHISR_DEFF))
+		return STD_OK;
+
+	/* Read number of errors */
+	ecc_errors_nb = hNand->Instance->BCHSR & FMC_BCHSR_DEN;
+
+	VERBOSE("%s: ECC Errors detected: %d\n", __func__,
+		ecc_errors_nb);
+
+	if (ecc_errors_nb > NAND_ECC_BCH8)
+		return STD_NOT_OK;
+
+	/*
+	 * Retrieve the error position corresponding to the error
+	 * number: error 2n + 1 is in FMC_BCHDSRn+1.EBP1, error 2n + 2
+	 * in FMC_BCHDSRn+1.EBP2. Only the registers holding errors are read.
+	 */
+	for (i = 0; i < ecc_errors_nb; i += 2) {
+		uint32_t bchdsr = (&hNand->Instance->BCHDSR1)[i / 2];
+
+		errorPosition[i] = bchdsr & FMC_BCHDSR1_EBP1;
+		errorPosition[i + 1] = (bchdsr & FMC_BCHDSR1_EBP2) >>
+			FMC_EBP2_MASK;
+	}
+
+	/* Error position indicates error bit number in binary */
+	/* Retrieve the mask of the wrong bit to correct */
+	for (i = 0; i < ecc_errors_nb; i++) {
+		VERBOSE("%s: ECC Error position: %d\n", __func__,
+			errorPosition[i]);
+		/* Correct only if error is in data area */
+		if (errorPosition[i] < 0x1000) {
+			/*
+			 * Retrieve the mask of the wrong bit
+			 * to correct
+			 */
+			uint32_t bitMask = BIT(errorPosition[i] & 0x07);
+
+			/*
+			 * Remove bit postion in the error position
+			 * (to have byte to correct)
+			 */
+			errorPosition[i] >>= 0x03;
+			VERBOSE("%s: ECC Error in data area\n",
+				__func__);
+
+			/* Fix the error : invert the wrong bit */
+			*(Buffer + errorPosition[i]) ^= bitMask;
+		} else {
+			VERBOSE("%s: ECC Error not in data area\n",
+				__func__);
+		}
+	}
+
+	return STD_OK;
+}
+
+/*
+ * ECC engines: number of ECC bytes per 512B sector in spare area, on 8 and
+ * 16-bit bus, and how to correct a sector.
+ */
+typedef struct {
+	uint32_t correctability;
+	uint32_t bytes[2];
+	Std_ReturnType (*syndrome)(NAND_HandleTypeDef *hNand, uint32_t *ecc);
+	Std_ReturnType (*correct)(NAND_HandleTypeDef *hNand, uint8_t *Buffer,
+				  uint8_t *EccBuffer, uint32_t ecc);
+} nand_ecc_engine;
+
+static const nand_ecc_engine nand_ecc_engines[] = {
+	{
+		/* Default engine */
+		.correctability = NAND_ECC_HAMMING1,
+		.bytes = { NAND_ECC_HAMMING1_BYTES_NB_8b,
+			   NAND_ECC_HAMMING1_BYTES_NB_16b },
+		.syndrome = NAND_Hamming_Syndrome,
+		.correct = NAND_Hamming_Correct,
+	},
+	{
+		.correctability = NAND_ECC_BCH4,
+		.bytes = { NAND_ECC_BCH4_BYTES_NB_8b,
+			   NAND_ECC_BCH4_BYTES_NB_16b },
+		.correct = NAND_BCH_Correct,
+	},
+	{
+		.correctability = NAND_ECC_BCH8,
+		.bytes = { NAND_ECC_BCH8_BYTES_NB_8b,
+			   NAND_ECC_BCH8_BYTES_NB_16b },
+		.correct = NAND_BCH_Correct,
+	},
+};
+
+/* Get the ECC engine matching the NAND ECC correctability */
+static const nand_ecc_engine *NAND_Get_Ecc_Engine(NAND_HandleTypeDef *hNand)
+{
+	uint32_t i;
+
+	for (i = 1U; i < ARRAY_SIZE(nand_ecc_engines); i++) {
+		if (nand_ecc_engines[i].correctability ==
+		    hNand->Info.ECCcorrectability)
+			return &nand_ecc_engines[i];
+	}
+
+	return &nand_ecc_engines[0];
+}
+
+/*****************************************************************************
+ *
+ * Function:            NAND_Read_Sector
+ *
+ * Description:         Read and correct a 512B sector of the page loaded
+ *                      in the page register, then its ECC bytes in the spare
+ *                      area
  *
  * Input parameters:    hNand: pointer to a NAND_HandleTypeDef structure
  *                      that contains the configuration information
  *                      for NAND module.
- *                      Address : pointer to NAND address structure
  *                      Buffer : pointer to destination read buffer
  *                      bch_sector_nb : 512B sector number in the page
- *
+ *                      change_column : data output is not at the sector yet
  *
  * Return:              Std_ReturnType
  *
  *****************************************************************************/
-Std_ReturnType NAND_Read_Logical_Page(NAND_HandleTypeDef *hNand,
-				      NAND_AddressTypeDef *Address,
-				      uint8_t *Buffer, uint32_t bch_sector_nb)
+static Std_ReturnType NAND_Read_Sector(NAND_HandleTypeDef *hNand,
+				       uint8_t *Buffer, uint32_t bch_sector_nb,
+				       bool change_column)
 {
 	uintptr_t deviceComMemAddr;
-	uintptr_t deviceAttrMemAddr;
 	uint32_t size = 0;
-	uint32_t index, bloc_nb, nb_pages_per_block, offset;
+	uint32_t index, offset;
 	uint32_t ecc_size = 0;
-	uint32_t rowAddr = 0, colAddr = 0;
+	uint32_t colAddr = 0;
 	uint8_t EccBuffer[NAND_ECC_BCH8_BYTES_NB_16b];
-	uint32_t heccr = 0;
+	uint32_t ecc = 0;
+	const nand_ecc_engine *engine = NAND_Get_Ecc_Engine(hNand);
 
 	assert(hNand);
 
 	/* Identify the device address */
 	deviceComMemAddr = FLASH_COMMON_MEM_BASE;
-	deviceAttrMemAddr = FLASH_ATTRIB_MEM_BASE;
-
-	bloc_nb = Address->Block;
-	nb_pages_per_block = hNand->Info.BlockSize;
-
-	/* Page and block to be read */
-	rowAddr = (bloc_nb * nb_pages_per_block) + Address->Page;
 
 	/* If NAND 8bit */
 	if (hNand->Info.BusWidth == EIGHT_BIT_ACCESS) {
@@ -1134,6 +1448,9 @@ Std_ReturnType NAND_Read_Logical_Page(NAND_HandleTypeDef *hNand,
 		size = NAND_ECC_PAGE_SECTOR / 2;
 	}
 
+	if (change_column)
+		NAND_Change_Read_Column(hNand, colAddr);
+
 	/* Reset ECC enabling */
 	hNand->Instance->PCReg &= ~FMC_PCR_ECCEN;
 	hNand->Instance->PCReg &= ~FMC_PCR_WE;
@@ -1142,9 +1459,6 @@ Std_ReturnType NAND_Read_Logical_Page(NAND_HandleTypeDef *hNand,
 	/* Clear status */
 	hNand->Instance->BCHICR = 0x1F;
 
-	/* Send read page command sequence */
-	NAND_Read_Page_Cmd(hNand, colAddr, rowAddr);
-
 	/* Get data into destination buffer */
 	/* If NAND 8bit */
 	if (hNand->Info.BusWidth == EIGHT_BIT_ACCESS) {
@@ -1160,42 +1474,15 @@ Std_ReturnType NAND_Read_Logical_Page(NAND_HandleTypeDef *hNand,
 			*Buffer16b++ = *(uint16_t *)deviceComMemAddr;
 	}
 
-	if (hNand->Info.ECCcorrectability == NAND_ECC_HAMMING1) {
-		/* During read of data , syndrome is calculated */
-		/* Wait until decoding error is ready */
-		uint32_t timerValInit = read_cntpct_el0();
-
-		while ((hNand->Instance->SR & FMC_SR_NWRF) != FMC_SR_NWRF) {
-			if ((read_cntpct_el0() - timerValInit) >
-			    NAND_ECC_CALCULATION_TIMEOUT_VAL_250MS) {
-				ERROR("%s: syndrome calculation timeout\n",
-				      __func__);
-				return STD_NOT_OK;
-			}
-		}
-
-		heccr = hNand->Instance->HECCR;
+	if (engine->syndrome != NULL) {
+		if (engine->syndrome(hNand, &ecc) != STD_OK)
+			return STD_NOT_OK;
 	}
 
 	/* Read now corresponding ECC bytes (7 or 13) in spare area */
 	/* Page and block to be read */
 
-	if (hNand->Info.ECCcorrectability == NAND_ECC_BCH4) {
-		if (hNand->Info.BusWidth == EIGHT_BIT_ACCESS)
-			ecc_size = NAND_ECC_BCH4_BYTES_NB_8b;
-		else
-			ecc_size = NAND_ECC_BCH4_BYTES_NB_16b;
-	} else if (hNand->Info.ECCcorrectability == NAND_ECC_BCH8) {
-		if (hNand->Info.BusWidth == EIGHT_BIT_ACCESS)
-			ecc_size = NAND_ECC_BCH8_BYTES_NB_8b;
-		else
-			ecc_size = NAND_ECC_BCH8_BYTES_NB_16b;
-	} else {
-		if (hNand->Info.BusWidth == EIGHT_BIT_ACCESS)
-			ecc_size = NAND_ECC_HAMMING1_BYTES_NB_8b;
-		else
-			ecc_size = NAND_ECC_HAMMING1_BYTES_NB_16b;
-	}
+	ecc_size = engine->bytes[hNand->Info.BusWidth];
 
 	offset = 2;
 
@@ -1214,33 +1501,7 @@ Std_ReturnType NAND_Read_Logical_Page(NAND_HandleTypeDef *hNand,
 	}
 
 	/* Send change read column command */
-	if (hNand->Info.BusWidth == EIGHT_BIT_ACCESS) {
-		*(__IO uint8_t *)(deviceComMemAddr | CMD_SECTION) =
-			NAND_CMD_CHANGE_1ST;
-
-		/* C1 */
-		*(__IO uint8_t *)(deviceComMemAddr | ADDR_SECTION) =
-			ADDR_1ST_CYCLE(colAddr);
-		/* C2 */
-		*(__IO uint8_t *)(deviceAttrMemAddr | ADDR_SECTION) =
-			ADDR_2ND_CYCLE(colAddr);
-
-		*(__IO uint8_t *)(deviceAttrMemAddr | CMD_SECTION) =
-			NAND_CMD_CHANGE_2ND;
-	} else {
-		*(__IO uint16_t *)(deviceComMemAddr | CMD_SECTION) =
-			NAND_CMD_CHANGE_1ST;
-
-		/* C1 */
-		*(__IO uint16_t *)(deviceComMemAddr | ADDR_SECTION) =
-			ADDR_1ST_CYCLE(colAddr);
-		/* C2 */
-		*(__IO uint16_t *)(deviceAttrMemAddr | ADDR_SECTION) =
-			ADDR_2ND_CYCLE(colAddr);
-
-		*(__IO uint16_t *)(deviceAttrMemAddr | CMD_SECTION) =
-			NAND_CMD_CHANGE_2ND;
-	}
+	NAND_Change_Read_Column(hNand, colAddr);
 
 	/* Get data into destination EccBuffer */
 
@@ -1260,101 +1521,118 @@ Std_ReturnType NAND_Read_Logical_Page(NAND_HandleTypeDef *hNand,
 		}
 	}
 
-	if (hNand->Info.ECCcorrectability == NAND_ECC_HAMMING1) {
-		int nb_errors;
+	return engine->correct(hNand, Buffer, EccBuffer, ecc);
+}
 
-		nb_errors = NAND_Hamming_Correction(Buffer, EccBuffer,
-						    heccr);
-		if ((nb_errors != 0) && (nb_errors != 1))
-			return STD_NOT_OK;
+/*****************************************************************************
+ *
+ * Function:            NAND_Read_Logical_Page
+ *
+ * Description:         Read 512B sector from NAND memory page
+ *
+ * Input parameters:    hNand: pointer to a NAND_HandleTypeDef structure
+ *                      that contains the configuration information
+ *                      for NAND module.
+ *                      Address : pointer to NAND address structure
+ *                      Buffer : pointer to destination read buffer
+ *                      bch_sector_nb : 512B sector number in the page
+ *
+ *
+ * Return:              Std_ReturnType
+ *
+ *****************************************************************************/
+Std_ReturnType NAND_Read_Logical_Page(NAND_HandleTypeDef *hNand,
+				      NAND_AddressTypeDef *Address,
+				      uint8_t *Buffer, uint32_t bch_sector_nb)
+{
+	uint32_t rowAddr, colAddr;
 
-	} else /* BCH error correction */ {
-		uint32_t ecc_errors_nb;
-		uint32_t i;
-		uint32_t errorPosition[8];
+	assert(hNand);
 
-		/*
-		 * During read of data and parity bits, syndrome is calculated,
-		 * then error location is launched
-		 * Wait until decoding error is ready
-		 */
-		uint32_t timerValInit = (uint32_t)read_cntpct_el0();
+	/* Page and block to be read */
+	rowAddr = (Address->Block * hNand->Info.BlockSize) + Address->Page;
 
-		while ((hNand->Instance->BCHISR & FMC_BCHISR_DERF) !=
-		       FMC_BCHISR_DERF) {
-			if (((uint32_t)read_cntpct_el0() - timerValInit) >
-			    NAND_ECC_CALCULATION_TIMEOUT_VAL_250MS)
-				return STD_NOT_OK;
-		}
+	/* Byte or word in page to be read */
+	colAddr = bch_sector_nb * NAND_ECC_PAGE_SECTOR;
+	if (hNand->Info.BusWidth != EIGHT_BIT_ACCESS)
+		colAddr /= 2;
 
-		/* Read decoding results */
-		/* Check if there were uncorrectable errors */
-		if (hNand->Instance->BCHISR & FMC_BCHISR_DUEF) {
-			VERBOSE("%s: Uncorrectable ECC Error\n", __func__);
-			return STD_NOT_OK;
-		}
+	/* Send read page command sequence */
+	NAND_Read_Page_Cmd(hNand, colAddr, rowAddr);
 
-		/* Check if there were errors */
-		if (!(hNand->Instance->BCHISR & FMC_BCHISR_DEFF))
-			return STD_OK;
+	return NAND_Read_Sector(hNand, Buffer, bch_sector_nb, false);
+}
 
-		/* Read number of errors */
-		ecc_errors_nb = hNand->Instance->BCHSR & FMC_BCHSR_DEN;
+/*****************************************************************************
+ *
+ * Function:            NAND_Read_Pages
+ *
+ * Description:         Read consecutive pages of a block, a whole page per
+ *                      page read command. When the device supports it, the
+ *                      READ CACHE SEQUENTIAL command loads the next page in
+ *                      the device while the current one is transferred.
+ *
+ * Input parameters:    hNand: pointer to a NAND_HandleTypeDef structure
+ *                      that contains the configuration information
+ *                      for NAND module.
+ *                      Address : pointer to NAND address structure of the
+ *                      first page
+ *                      Buffer : pointer to destination read buffer
+ *                      nb_pages : number of pages to read
+ *
+ * Return:              Std_ReturnType
+ *
+ *****************************************************************************/
+Std_ReturnType NAND_Read_Pages(NAND_HandleTypeDef *hNand,
+			       NAND_AddressTypeDef *Address,
+			       uint8_t *Buffer, uint32_t nb_pages)
+{
+	uint32_t nb_sectors = hNand->Info.PageSize / NAND_ECC_PAGE_SECTOR;
+	uint32_t rowAddr;
+	uint32_t page, sector;
+	bool cache_read;
 
-		VERBOSE("%s: ECC Errors detected: %d\n", __func__,
-			ecc_errors_nb);
+	assert(hNand);
+	assert((Address->Page + nb_pages) <= hNand->Info.BlockSize);
 
-		/* Retrieve the error position corresponding to the error
-		 * number
-		 */
-		/* Error 1 position : FMC_BCHDSR1.EBP1 */
-		errorPosition[0] = hNand->Instance->BCHDSR1 & FMC_BCHDSR1_EBP1;
-		/* Error 2 position : FMC_BCHDSR1.EBP2 */
-		errorPosition[1] = (hNand->Instance->BCHDSR1 & FMC_BCHDSR1_EBP2)
-			>> FMC_EBP2_MASK;
-		/* Error 3 position : FMC_BCHDSR2.EBP1 */
-		errorPosition[2] = hNand->Instance->BCHDSR2 & FMC_BCHDSR2_EBP1;
-		/* Error 4 position : FMC_BCHDSR2.EBP2 */
-		errorPosition[3] = (hNand->Instance->BCHDSR2 & FMC_BCHDSR2_EBP2)
-			>> FMC_EBP2_MASK;
-		/* Error 5 position : FMC_BCHDSR3.EBP1 */
-		errorPosition[4] = hNand->Instance->BCHDSR3 & FMC_BCHDSR3_EBP1;
-		/* Error 6 position : FMC_BCHDSR3.EBP2 */
-		errorPosition[5] = (hNand->Instance->BCHDSR3 & FMC_BCHDSR3_EBP2)
-			>> FMC_EBP2_MASK;
-		/* Error 7 position : FMC_BCHDSR4.EBP1 */
-		errorPosition[6] = hNand->Instance->BCHDSR4 & FMC_BCHDSR4_EBP1;
-		/* Error 8 position : FMC_BCHDSR4.EBP2 */
-		errorPosition[7] = (hNand->Instance->BCHDSR4 & FMC_BCHDSR4_EBP2)
-			>> FMC_EBP2_MASK;
-
-		/* Error position indicates error bit number in binary */
-		/* Retrieve the mask of the wrong bit to correct */
-		for (i = 0; i < ecc_errors_nb; i++) {
-			VERBOSE("%s: ECC Error position: %d\n", __func__,
-				errorPosition[i]);
-			/* Correct only if error is in data area */
-			if (errorPosition[i] < 0x1000) {
-				/*
-				 * Retrieve the mask of the wrong bit
-				 * to correct
-				 */
-				uint32_t bitMask = BIT(errorPosition[i] & 0x07);
-
-				/*
-				 * Remove bit postion in the error position
-				 * (to have byte to correct)
-				 */
-				errorPosition[i] >>= 0x03;
-				VERBOSE("%s: ECC Error in data area\n",
-					__func__);
-
-				/* Fix the error : invert the wrong bit */
-				*(Buffer + errorPosition[i]) ^= bitMask;
-			} else {
-				VERBOSE("%s: ECC Error not in data area\n",
-					__func__);
+	if (nb_pages == 0U)
+		return STD_OK;
+
+	cache_read = (hNand->Info.read_cache != 0U) && (nb_pages > 1U);
+
+	/* Page and block to be read */
+	rowAddr = (Address->Block * hNand->Info.BlockSize) + Address->Page;
+
+	/* Send read page command sequence */
+	NAND_Read_Page_Cmd(hNand, 0U, rowAddr);
+
+	for (page = 0U; page < nb_pages; page++) {
+		if (cache_read) {
+			/*
+			 * Move the loaded page to the cache register, and
+			 * start loading the next one, except for the last.
+			 */
+			if (page < (nb_pages - 1U))
+				NAND_Send_Cmd(hNand, NAND_CMD_READ_CACHE_SEQ);
+			else
+				NAND_Send_Cmd(hNand, NAND_CMD_READ_CACHE_END);
+		} else if (page != 0U) {
+			NAND_Read_Page_Cmd(hNand, 0U, rowAddr + page);
+		}
+
+		/* Data output starts at column 0 after a read command */
+		for (sector = 0U; sector < nb_sectors; sector++) {
+			if (NAND_Read_Sector(hNand, Buffer, sector,
+					     sector != 0U) != STD_OK) {
+				/* Stop loading pages in the background */
+				if (cache_read && (page < (nb_pages - 1U)))
+					NAND_Send_Cmd(hNand,
+						      NAND_CMD_READ_CACHE_END);
+
+				return STD_NOT_OK;
 			}
+
+			Buffer += NAND_ECC_PAGE_SECTOR;
 		}
 	}
 
@@ -1476,6 +1754,177 @@ uint32_t NAND_Check_Bad_Block(NAND_HandleTypeDef *hNand,
 	return block_status;
 }
 
+static void nand_bbt_set(uint32_t block, uint32_t block_status)
+{
+	uint8_t mask = (uint8_t)BIT(block % 8U);
+
+	bbt_known[block / 8U] |= mask;
+
+	if (block_status == BAD_BLOCK)
+		bbt_bad[block / 8U] |= mask;
+	else
+		bbt_bad[block / 8U] &= (uint8_t)~mask;
+}
+
+/*
+ * Look for an on-flash bad block table, main or mirror, in the last blocks
+ * of the device. Return the block holding the most recent one, or -1.
+ */
+static int nand_bbt_find(NAND_HandleTypeDef *hNand)
+{
+	NAND_AddressTypeDef address = { 0 };
+	uint32_t i;
+	uint8_t version = 0U;
+	int bbt_block = -1;
+
+	for (i = 1U; (i <= NAND_BBT_SCAN_MAXBLOCKS) &&
+	     (i < hNand->Info.BlockNb); i++) {
+		address.Block = (uint16_t)(hNand->Info.BlockNb - i);
+
+		if (NAND_Read_Logical_Page(hNand, &address, bbt_sector,
+					   0U) != STD_OK)
+			continue;
+
+		if ((memcmp(bbt_sector, bbt_main_pattern,
+			    NAND_BBT_PATTERN_LEN) != 0) &&
+		    (memcmp(bbt_sector, bbt_mirror_pattern,
+			    NAND_BBT_PATTERN_LEN) != 0))
+			continue;
+
+		if ((bbt_block < 0) ||
+		    (bbt_sector[NAND_BBT_VERSION_OFFSET] > version)) {
+			bbt_block = (int)address.Block;
+			version = bbt_sector[NAND_BBT_VERSION_OFFSET];
+		}
+	}
+
+	return bbt_block;
+}
+
+/* Fill the bad block table from the on-flash table stored in bbt_block */
+static Std_ReturnType nand_bbt_load(NAND_HandleTypeDef *hNand,
+				    uint32_t bbt_block)
+{
+	NAND_AddressTypeDef address = { 0 };
+	uint32_t nb_sectors = hNand->Info.PageSize / BCH_PAGE_SECTOR;
+	uint32_t nb_blocks = MIN(hNand->Info.BlockNb,
+				 (uint32_t)NAND_BBT_MAX_BLOCKS);
+	uint32_t offset = NAND_BBT_DATA_OFFSET;
+	uint32_t sector = 0U;
+	uint32_t block = 0U;
+
+	address.Block = (uint16_t)bbt_block;
+
+	while (block < nb_blocks) {
+		if (NAND_Read_Logical_Page(hNand, &address, bbt_sector,
+					   sector) != STD_OK)
+			return STD_NOT_OK;
+
+		while ((offset < BCH_PAGE_SECTOR) && (block < nb_blocks)) {
+			uint32_t entries = bbt_sector[offset++];
+			uint32_t shift;
+
+			for (shift = 0U; (shift < 8U) && (block < nb_blocks);
+			     shift += NAND_BBT_ENTRY_BITS) {
+				uint32_t entry = (entries >> shift) &
+						 NAND_BBT_ENTRY_GOOD;
+
+				if (entry == NAND_BBT_ENTRY_GOOD)
+					nand_bbt_set(block++, GOOD_BLOCK);
+				else
+					nand_bbt_set(block++, BAD_BLOCK);
+			}
+		}
+
+		offset = 0U;
+		sector++;
+		if (sector == nb_sectors) {
+			sector = 0U;
+			address.Page++;
+			if (address.Page == hNand->Info.BlockSize)
+				return STD_NOT_OK;
+		}
+	}
+
+	/* Blocks reserved for the table are not available for data */
+	for (block = hNand->Info.BlockNb - NAND_BBT_SCAN_MAXBLOCKS;
+	     block < nb_blocks; block++)
+		nand_bbt_set(block, BAD_BLOCK);
+
+	return STD_OK;
+}
+
+/**
+ * @brief  Initialize the bad block table, once. It is loaded from the
+ *         on-flash table when Linux has written one. Otherwise, the bad
+ *         block markers of each block are read the first time the block
+ *         status is requested.
+ * @param  hNand: pointer to a NAND_HandleTypeDef structure that contains
+ *                the configuration information for NAND module.
+ * @retval None
+ */
+void NAND_Init_Bad_Block_Table(NAND_HandleTypeDef *hNand)
+{
+	int bbt_block;
+
+	assert(hNand);
+
+	if (bbt_initialized)
+		return;
+
+	bbt_initialized = true;
+
+	bbt_block = nand_bbt_find(hNand);
+	if (bbt_block < 0) {
+		VERBOSE("nand: no bad block table found\n");
+		return;
+	}
+
+	if (nand_bbt_load(hNand, (uint32_t)bbt_block) != STD_OK) {
+		WARN("nand: cannot read bad block table at block %d\n",
+		     bbt_block);
+		memset(bbt_known, 0, sizeof(bbt_known));
+		memset(bbt_bad, 0, sizeof(bbt_bad));
+		return;
+	}
+
+	VERBOSE("nand: bad block table loaded from block %d\n", bbt_block);
+}
+
+/**
+ * @brief  Get the status of a block from the bad block table
+ * @param  hNand: pointer to a NAND_HandleTypeDef structure that contains
+ *                the configuration information for NAND module.
+ *         block: block number
+ * @retval BAD_BLOCK or GOOD_BLOCK
+ */
+uint32_t NAND_Get_Block_Status(NAND_HandleTypeDef *hNand, uint32_t block)
+{
+	NAND_AddressTypeDef address = { 0 };
+	uint32_t block_status;
+
+	assert(hNand);
+
+	if (block >= hNand->Info.BlockNb)
+		return BAD_BLOCK;
+
+	if ((block < NAND_BBT_MAX_BLOCKS) &&
+	    ((bbt_known[block / 8U] & BIT(block % 8U)) != 0U)) {
+		if ((bbt_bad[block / 8U] & BIT(block % 8U)) != 0U)
+			return BAD_BLOCK;
+
+		return GOOD_BLOCK;
+	}
+
+	address.Block = (uint16_t)block;
+	block_status = NAND_Check_Bad_Block(hNand, &address);
+
+	if (block < NAND_BBT_MAX_BLOCKS)
+		nand_bbt_set(block, block_status);
+
+	return block_status;
+}
+
 /**
  * @brief  Increment the NAND memory address
  * @param  hNand: pointer to a NAND_HandleTypeDef structure that contains
@@ -1499,7 +1948,8 @@ Std_ReturnType NAND_Address_Inc(NAND_HandleTypeDef *hNand,
 		/* Search for next valid block */
 		Address->Block++;
 		while (Address->Block < hNand->Info.BlockNb &&
-		       NAND_Check_Bad_Block(hNand, Address) == BAD_BLOCK)
+		       NAND_Get_Block_Status(hNand, Address->Block) ==
+		       BAD_BLOCK)
 			Address->Block++;
 
 		if (Address->Block == hNand->Info.BlockNb)
@@ -1509,6 +1959,26 @@ Std_ReturnType NAND_Address_Inc(NAND_HandleTypeDef *hNand,
 	return STD_OK;
 }
 
+/**
+ * @brief  Check in the ONFI parameter page if the read cache commands are
+ *	   supported, when bootrom has initialized NAND.
+ * @param  hNand: pointer to a NAND_HandleTypeDef structure that contains
+ *                the configuration information for NAND module.
+ * @retval None
+ */
+static void Nand_CheckReadCache(NAND_HandleTypeDef *hNand)
+{
+	uint8_t buffer[PARAM_PAGE_SIZE];
+
+	/* ECC logic must not be enabled during Read Parameter Page */
+	hNand->Instance->PCReg &= ~FMC_PCR_ECCEN;
+
+	if (Nand_GetParameterPage(hNand, buffer) != STD_OK)
+		return;
+
+	hNand->Info.read_cache = (buffer[8] & NAND_OPT_CMD_READ_CACHE) != 0U;
+}
+
 /**
  * @brief  Initialize driver only if needed:
  *	   bootrom must have initialize NAND and bootcontext
@@ -1539,6 +2009,10 @@ Std_ReturnType nand_initialize(NAND_HandleTypeDef *hnand)
 		/* Initialization done, just need to set correct timing */
 		Nand_Init(hnand, hnand->Info.BusWidth,
 			  hnand->Info.ECCcorrectability);
+
+		/* Parameter page is read on 8 bits */
+		if (hnand->Info.BusWidth == EIGHT_BIT_ACCESS)
+			Nand_CheckReadCache(hnand);
 	}
 	return STD_OK;
 }
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2020, STMicroelectronics - All Rights Reserved
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef NAND_HAMMING_H
+#define NAND_HAMMING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Syndrome helpers of the FMC2 Hamming correction, for 512-byte sectors.
+ * The syndrome is the 24-bit xor of the ECC read from the spare area and
+ * the one computed by the FMC2: bit 2k + 1 and bit 2k are the parities of
+ * the data bits whose address has bit k set and clear respectively. They
+ * only depend on stdint.h, so tools/nand_hamming_test can check them on
+ * the host.
+ */
+#define NAND_HAMMING_SYNDROME_MASK	0x00FFFFFFU
+#define NAND_HAMMING_EVEN_BITS		0x00555555U
+
+/* Number of bits set to one in v */
+static inline uint32_t nand_hamming_bit_count(uint32_t v)
+{
+	v = v - ((v >> 1) & 0x55555555U);
+	v = (v & 0x33333333U) + ((v >> 2) & 0x33333333U);
+	v = (v + (v >> 4)) & 0x0F0F0F0FU;
+
+	return (v * 0x01010101U) >> 24;
+}
+
+/*
+ * A single bit error in data flips one bit of each pair of parity bits,
+ * as in Linux's nand_ecc.
+ */
+static inline bool nand_hamming_data_error(uint32_t syndrome)
+{
+	return ((syndrome ^ (syndrome >> 1)) & NAND_HAMMING_EVEN_BITS) ==
+	       NAND_HAMMING_EVEN_BITS;
+}
+
+/*
+ * Bit address in the sector of a single data error: the odd syndrome bits,
+ * compressed with shift/mask steps. Bits 0-2 give the bit in the byte and
+ * bits 3-11 the byte in the sector.
+ */
+static inline uint32_t nand_hamming_error_address(uint32_t syndrome)
+{
+	uint32_t address;
+
+	address = (syndrome >> 1) & NAND_HAMMING_EVEN_BITS;
+	address = (address | (address >> 1)) & 0x00333333U;
+	address = (address | (address >> 2)) & 0x000F0F0FU;
+	address = (address | (address >> 4)) & 0x00FF00FFU;
+	address = (address | (address >> 8)) & 0x0000FFFFU;
+
+	return address;
+}
+
+#endif /* NAND_HAMMING_H */
@@ -18,6 +18,12 @@
 #define QSPI_COMPAT		"st,stm32f469-qspi"
 
 #define TIMEOUT_100_US		us2tick(100)
+#define TIMEOUT_1_MS		us2tick(1000)
+
+/* Bytes drained from the FIFO at once in indirect mode, at most 32 */
+#define QSPI_FIFO_BURST		16U
+#define QSPI_CR_FTHRES		(((QSPI_FIFO_BURST - 1U) << \
+				  QSPI_CR_FTHRES_SHIFT) & QSPI_CR_FTHRES_MASK)
 
 /* QSPI device functions */
 static int qspi_dev_open(const uintptr_t init_params,
@@ -40,6 +46,8 @@ static struct dt_node_info qspi_node_info;
 static uintptr_t qspi_mm_base;
 static size_t qspi_mm_size;
 static bool qspi_memory_map;
+/* CCR is in memory mapped mode, a prefetch may be ongoing */
+static bool qspi_mm_enabled;
 
 static const io_dev_connector_t qspi_dev_connector = {
 	.dev_open = qspi_dev_open
@@ -102,8 +110,11 @@ static int qspi_dev_open(const uintptr_t init_params, io_dev_info_t **dev_info)
 
 		/*
 		 * Indirect mode is already initialized by bootrom:
-		 * no configuration to be done.
+		 * only the FIFO threshold is set, for burst reads.
 		 */
+		hsd->instance->CR = (hsd->instance->CR &
+				     ~QSPI_CR_FTHRES_MASK) | QSPI_CR_FTHRES;
+
 		return 0;
 	}
 
@@ -145,14 +156,15 @@ static int qspi_dev_open(const uintptr_t init_params, io_dev_info_t **dev_info)
 
 	/* Check if QuadSPI was configured in dual flash mode */
 	if ((hsd->instance->CR & QSPI_CR_DFM) != 0U) {
-		hsd->instance->CR = QSPI_CR_EN | presc | QSPI_CR_DFM;
+		hsd->instance->CR = QSPI_CR_EN | presc | QSPI_CR_DFM |
+				    QSPI_CR_FTHRES;
 		if (hsd->is_dual == 0U) {
 			WARN("Dual NOR configured in IP\n");
 			WARN("  but set as single in boot context\n");
 			WARN("  -> Try Dual NOR boot\n");
 		}
 	} else {
-		hsd->instance->CR = QSPI_CR_EN | presc;
+		hsd->instance->CR = QSPI_CR_EN | presc | QSPI_CR_FTHRES;
 		if (hsd->is_dual != 0U) {
 			WARN("Single NOR configured in IP\n");
 			WARN("  but set as dual in boot context\n");
@@ -162,6 +174,7 @@ static int qspi_dev_open(const uintptr_t init_params, io_dev_info_t **dev_info)
 
 	hsd->instance->DCR = fsize | QSPI_DCR_CSHT;
 	hsd->instance->CCR = QSPI_DFLT_READ_FLAGS | QSPI_CCR_FMODE_MM;
+	qspi_mm_enabled = true;
 
 	return 0;
 }
@@ -171,12 +184,11 @@ static int qspi_dev_init(io_dev_info_t *dev_info, const uintptr_t init_params)
 	return 0;
 }
 
-/* Close a connection to the qspi device */
-static int qspi_dev_close(io_dev_info_t *dev_info)
+/* Abort the ongoing transfer or memory mapped prefetch */
+static int qspi_abort(void)
 {
 	uint64_t start;
 
-	/* Send Abort command to end all transfers */
 	hsd->instance->CR |= QSPI_CR_ABORT;
 
 	start = timeout_start();
@@ -186,9 +198,18 @@ static int qspi_dev_close(io_dev_info_t *dev_info)
 		}
 	}
 
+	qspi_mm_enabled = false;
+
 	return 0;
 }
 
+/* Close a connection to the qspi device */
+static int qspi_dev_close(io_dev_info_t *dev_info)
+{
+	/* Send Abort command to end all transfers */
+	return qspi_abort();
+}
+
 /* Open a file on the qspi device */
 static int qspi_block_open(io_dev_info_t *dev_info, const uintptr_t spec,
 			   io_entity_t *entity)
@@ -205,7 +226,25 @@ static int qspi_block_seek(io_entity_t *entity, int mode,
 	return 0;
 }
 
-/* Read blocks in indirect mode */
+/* Wait until a burst can be read from the FIFO, or the transfer is done */
+static int qspi_wait_fifo(void)
+{
+	uint64_t start = timeout_start();
+
+	while ((hsd->instance->SR & (QSPI_SR_FTF | QSPI_SR_TCF)) == 0U) {
+		if (timeout_elapsed(start, TIMEOUT_1_MS)) {
+			return -ETIMEDOUT;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Read blocks in indirect mode. The FIFO is drained one word at a time,
+ * a whole burst as soon as the threshold flag is set. Bytes are only read one
+ * by one up to a word aligned buffer, and for the last bytes.
+ */
 static int qspi_block_read_indr(io_entity_t *entity, uintptr_t buffer,
 				size_t length, size_t *length_read)
 {
@@ -217,6 +256,16 @@ static int qspi_block_read_indr(io_entity_t *entity, uintptr_t buffer,
 
 	assert(hsd);
 
+	*length_read = 0U;
+
+	/* Memory mapped mode must be stopped before changing mode */
+	if (qspi_mm_enabled) {
+		ret = qspi_abort();
+		if (ret != 0) {
+			return ret;
+		}
+	}
+
 	qspi_dr_u8 = (uint8_t *)&hsd->instance->DR;
 
 	/* Clear all flags */
@@ -226,6 +275,32 @@ static int qspi_block_read_indr(io_entity_t *entity, uintptr_t buffer,
 	hsd->instance->CCR = QSPI_DFLT_READ_FLAGS | QSPI_CCR_FMODE;
 	hsd->instance->AR = seek_offset;
 
+	while ((local_length != 0U) &&
+	       (((uintptr_t)data & (sizeof(uint32_t) - 1U)) != 0U)) {
+		*data++ = *qspi_dr_u8;
+		local_length--;
+	}
+
+	while (local_length >= sizeof(uint32_t)) {
+		uint32_t nb_words = MIN(local_length, QSPI_FIFO_BURST) /
+				    sizeof(uint32_t);
+
+		if (nb_words == (QSPI_FIFO_BURST / sizeof(uint32_t))) {
+			ret = qspi_wait_fifo();
+			if (ret != 0) {
+				ERROR("%s: FIFO timeout\n", __func__);
+				qspi_abort();
+				return ret;
+			}
+		}
+
+		local_length -= nb_words * sizeof(uint32_t);
+		while (nb_words-- != 0U) {
+			*(uint32_t *)data = hsd->instance->DR;
+			data += sizeof(uint32_t);
+		}
+	}
+
 	while (local_length != 0U) {
 		*data++ = *qspi_dr_u8;
 		local_length--;
@@ -244,72 +319,68 @@ static int qspi_block_read_indr(io_entity_t *entity, uintptr_t buffer,
 	return ret;
 }
 
+/*
+ * Read blocks through the memory mapped area. Sequential reads carry on with
+ * the data prefetched by the previous one, the prefetch is only aborted when
+ * switching to indirect mode or when the file is closed.
+ */
 static int qspi_block_read_mm_part(io_entity_t *entity, uintptr_t buffer,
 				   size_t length, size_t *length_read)
 {
-	uint64_t start;
-	int ret = 0;
-
 	assert(hsd);
 
+	if (!qspi_mm_enabled) {
+		hsd->instance->CCR = QSPI_DFLT_READ_FLAGS | QSPI_CCR_FMODE_MM;
+		qspi_mm_enabled = true;
+	}
+
 	memcpy((uint8_t *)buffer, (uint8_t *)qspi_mm_base + seek_offset,
 	       length);
 
 	*length_read = length;
 
-	start = timeout_start();
-	while ((hsd->instance->SR & QSPI_SR_BUSY) != 0U) {
-		if (timeout_elapsed(start, TIMEOUT_100_US)) {
-			ret = -ETIMEDOUT;
-			break;
-		}
-	}
-
-	/* Send abort to avoid prefetch issues */
-	hsd->instance->CR |= QSPI_CR_ABORT;
-
-	start = timeout_start();
-	while ((hsd->instance->CR & QSPI_CR_ABORT) != 0U) {
-		if (timeout_elapsed(start, TIMEOUT_100_US)) {
-			ret = -ETIMEDOUT;
-			break;
-		}
-	}
-
-	return ret;
-
+	return 0;
 }
 
-/* Read blocks in memory map mode */
+/*
+ * Read blocks in memory map mode. The last bytes of the device are read in
+ * indirect mode, to avoid a prefetch beyond the end of the memory.
+ */
 static int qspi_block_read_mm(io_entity_t *entity, uintptr_t buffer,
 			      size_t length, size_t *length_read)
 {
-	if (seek_offset + length + 1 >= qspi_mm_size) {
-		if (length > QSPI_NOR_LBA_SIZE) {
-			size_t length_read_mm, length_read_indr;
+	size_t length_read_mm, length_read_indr;
+	int ret;
+
+	if (seek_offset + length + 1 < qspi_mm_size) {
+		return qspi_block_read_mm_part(entity, buffer, length,
+					       length_read);
+	}
 
-			qspi_block_read_mm_part(entity, buffer,
-						length - QSPI_NOR_LBA_SIZE,
-						&length_read_mm);
+	if (length <= QSPI_NOR_LBA_SIZE) {
+		return qspi_block_read_indr(entity, buffer, length,
+					    length_read);
+	}
 
-			seek_offset += length - QSPI_NOR_LBA_SIZE;
+	ret = qspi_block_read_mm_part(entity, buffer,
+				      length - QSPI_NOR_LBA_SIZE,
+				      &length_read_mm);
+	if (ret != 0) {
+		return ret;
+	}
 
-			qspi_block_read_indr(entity, buffer + length -
-					     QSPI_NOR_LBA_SIZE,
-					     QSPI_NOR_LBA_SIZE,
-					     &length_read_indr);
+	seek_offset += length - QSPI_NOR_LBA_SIZE;
 
-			*length_read = length_read_mm + length_read_indr;
-		} else {
-			qspi_block_read_indr(entity, buffer, length,
-					     length_read);
-		}
-	} else {
-		qspi_block_read_mm_part(entity, buffer, length, length_read);
+	ret = qspi_block_read_indr(entity, buffer + length -
+				   QSPI_NOR_LBA_SIZE, QSPI_NOR_LBA_SIZE,
+				   &length_read_indr);
+	if (ret != 0) {
+		return ret;
 	}
 
-	return 0;
+	*length_read = length_read_mm + length_read_indr;
 
+	return 0;
 }
 
 /* Read data from a file on the qspi device */
@@ -326,6 +397,11 @@ static int qspi_block_read(io_entity_t *entity, uintptr_t buffer,
 /* Close a file on the qspi device */
 static int qspi_block_close(io_entity_t *entity)
 {
+	/* Stop the memory mapped prefetch once the file is read */
+	if (qspi_mm_enabled) {
+		return qspi_abort();
+	}
+
 	return 0;
 }
 
@@ -7,6 +7,7 @@
 #ifndef __IMAGE_DECOMPRESS_H__
 #define __IMAGE_DECOMPRESS_H__
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -16,9 +17,22 @@ typedef int (decompressor_t)(uintptr_t *in_buf, size_t in_len,
 			     uintptr_t *out_buf, size_t out_len,
 			     uintptr_t work_buf, size_t work_len);
 
+/* Decompressor reading its input from an open IO handle */
+typedef int (stream_decompressor_t)(uintptr_t in_handle, size_t in_len,
+				    uintptr_t *out_buf, size_t out_len,
+				    uintptr_t work_buf, size_t work_len);
+
 void image_decompress_init(uintptr_t buf_base, uint32_t buf_size,
 			   decompressor_t *decompressor);
 void image_decompress_prepare(struct image_info *info);
 int image_decompress(struct image_info *info);
 
+#if IMAGE_DECOMPRESS_STREAM
+void image_decompress_stream_init(uintptr_t buf_base, uint32_t buf_size,
+				  stream_decompressor_t *decompressor);
+bool image_decompress_stream_pending(const struct image_info *info);
+int image_decompress_stream(struct image_info *info, uintptr_t image_handle,
+			    size_t image_size);
+#endif
+
 #endif /* __IMAGE_DECOMPRESS_H___ */
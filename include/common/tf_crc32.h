@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) 2020, ARM Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef __TF_CRC32_H__
+#define __TF_CRC32_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* CRC-32 as used by gzip and GPT, with the same chaining as zlib's crc32() */
+uint32_t tf_crc32(uint32_t crc, const unsigned char *buf, size_t size);
+
+#endif /* __TF_CRC32_H__ */
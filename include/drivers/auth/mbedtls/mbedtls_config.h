@@ -104,4 +104,13 @@
 #define TF_MBEDTLS_HEAP_SIZE		U(7168)
 #endif
 
+/*
+ * Number of public keys kept parsed by the crypto module, allocated from the
+ * mbed TLS heap. 3 covers the ROT, trusted world and non-trusted world keys.
+ * Keys are freed if the heap runs out. Set to 0 to parse keys on each use.
+ */
+#ifndef TF_MBEDTLS_PK_CACHE_SIZE
+#define TF_MBEDTLS_PK_CACHE_SIZE	3
+#endif
+
 #endif /* __MBEDTLS_CONFIG_H__ */
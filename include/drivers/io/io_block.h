@@ -9,6 +9,14 @@
 
 #include <io_storage.h>
 
+/*
+ * Number of cache lines kept per block device. The cache is disabled when
+ * the platform doesn't define it.
+ */
+#if !PLAT_IO_BLOCK_CACHE_LINES
+# define PLAT_IO_BLOCK_CACHE_LINES	0
+#endif	/* PLAT_IO_BLOCK_CACHE_LINES */
+
 /* block devices ops */
 typedef struct io_block_ops {
 	size_t	(*read)(int lba, uintptr_t buf, size_t size);
@@ -19,10 +27,22 @@ typedef struct io_block_dev_spec {
 	io_block_spec_t	buffer;
 	io_block_ops_t	ops;
 	size_t		block_size;
+	/*
+	 * Optional cache memory, split in PLAT_IO_BLOCK_CACHE_LINES lines.
+	 * Each line is a block size multiple, and is entirely filled on a
+	 * miss, which acts as a read-ahead for sequential accesses.
+	 */
+	io_block_spec_t	cache;
 } io_block_dev_spec_t;
 
+typedef struct io_block_cache_stats {
+	unsigned int	hits;
+	unsigned int	misses;
+} io_block_cache_stats_t;
+
 struct io_dev_connector;
 
 int register_io_dev_block(const struct io_dev_connector **dev_con);
+void io_block_get_cache_stats(io_block_cache_stats_t *stats);
 
 #endif /* __IO_BLOCK_H__ */
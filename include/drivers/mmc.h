@@ -127,6 +127,11 @@ struct mmc_ops {
 	int (*set_ios)(unsigned int clk, unsigned int width);
 	int (*prepare)(int lba, uintptr_t buf, size_t size);
 	int (*read)(int lba, uintptr_t buf, size_t size);
+	/*
+	 * Optional: check whether the data of a read is in memory without
+	 * blocking, return -EBUSY while it is still in flight.
+	 */
+	int (*read_poll)(int lba, uintptr_t buf, size_t size);
 	int (*write)(int lba, const uintptr_t buf, size_t size);
 };
 
@@ -248,7 +253,19 @@ struct mmc_device_info {
 	enum mmc_device_type	mmc_dev_type;	/* Type of MMC */
 };
 
+/* Read started by mmc_read_blocks_start() */
+struct mmc_read_req {
+	int			lba;	/* First block to read */
+	uintptr_t		buf;	/* Destination buffer */
+	size_t			size;	/* Size in bytes, multiple of blocks */
+	int			status;	/* -EBUSY while in flight */
+};
+
 size_t mmc_read_blocks(int lba, uintptr_t buf, size_t size);
+int mmc_read_blocks_start(struct mmc_read_req *req, int lba, uintptr_t buf,
+			  size_t size);
+int mmc_read_blocks_poll(struct mmc_read_req *req);
+size_t mmc_read_blocks_wait(struct mmc_read_req *req);
 size_t mmc_write_blocks(int lba, const uintptr_t buf, size_t size);
 size_t mmc_erase_blocks(int lba, size_t size);
 size_t mmc_rpmb_read_blocks(int lba, uintptr_t buf, size_t size);
@@ -18,6 +18,17 @@ CASSERT(PLAT_PARTITION_MAX_ENTRIES <= 128, assert_plat_partition_max_entries);
 
 #define PARTITION_BLOCK_SIZE		512
 
+/*
+ * Size of the buffer the GPT entry array is read through. By default, an
+ * array of 128 entries is read in a single transfer.
+ */
+#if !PLAT_PARTITION_ENTRY_BUF_SIZE
+# define PLAT_PARTITION_ENTRY_BUF_SIZE	(128 * 128)
+#endif	/* PLAT_PARTITION_ENTRY_BUF_SIZE */
+
+CASSERT((PLAT_PARTITION_ENTRY_BUF_SIZE % PARTITION_BLOCK_SIZE) == 0,
+	assert_plat_partition_entry_buf_size);
+
 #define EFI_NAMELEN			36
 
 typedef struct partition_entry {
@@ -19,6 +19,8 @@
 #define QSPI_CR_TCEN			0x00000008
 #define QSPI_CR_SSHIFT			0x00000010
 #define QSPI_CR_DFM			0x00000040
+#define QSPI_CR_FTHRES_MASK		0x00001F00
+#define QSPI_CR_FTHRES_SHIFT		8
 #define QSPI_CR_PRESCALER_SHIFT		24
 
 #define QSPI_DCR_CSHT			0x00000100
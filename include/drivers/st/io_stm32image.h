@@ -9,6 +9,7 @@
 
 #include <io_driver.h>
 #include <partition.h>
+#include <stdbool.h>
 
 #define MAX_LBA_SIZE		512
 #define MAX_PART_NAME_SIZE	(EFI_NAMELEN + 1)
@@ -25,6 +26,14 @@ struct stm32image_device_info {
 	struct stm32image_part_info part_info[STM32_PART_NUM];
 	uint32_t device_size;
 	uint32_t lba_size;
+	bool byte_access;	/* Backend can be read at any offset */
+	/*
+	 * Optional asynchronous read of LBA aligned data from the backend
+	 * device: read_start() returns as soon as the transfer is started,
+	 * read_wait() waits for its end and returns the number of bytes read.
+	 */
+	int (*read_start)(uintptr_t offset, uintptr_t buffer, size_t length);
+	size_t (*read_wait)(void);
 };
 
 int register_io_dev_stm32image(const io_dev_connector_t **dev_con);
@@ -31,6 +31,11 @@
 #define GOOD_BLOCK 0
 #define BAD_BLOCK  1
 
+/* Number of blocks tracked by the bad block table, 2 bits per block */
+#if !NAND_BBT_MAX_BLOCKS
+# define NAND_BBT_MAX_BLOCKS	4096
+#endif	/* NAND_BBT_MAX_BLOCKS */
+
 /****************  Bit definition for FMC_PCR register  *******************/
 /* Wait feature enable bit */
 #define  FMC_PCR_PWAITEN	((uint32_t)0x00000002)
@@ -210,6 +215,8 @@ typedef struct {
 	uint32_t page_size_shift;
 	uint32_t block_size_shift;
 
+	uint32_t read_cache;       /* READ CACHE commands are supported */
+
 	nand_timings timings;
 
 } NAND_InfoTypeDef;
@@ -242,8 +249,13 @@ Std_ReturnType nand_initialize(NAND_HandleTypeDef *hnand);
 Std_ReturnType NAND_Read_Logical_Page(NAND_HandleTypeDef *hNand,
 				      NAND_AddressTypeDef *Address,
 				      uint8_t *Buffer, uint32_t bch_sector_nb);
+Std_ReturnType NAND_Read_Pages(NAND_HandleTypeDef *hNand,
+			       NAND_AddressTypeDef *Address,
+			       uint8_t *Buffer, uint32_t nb_pages);
 uint32_t NAND_Check_Bad_Block(NAND_HandleTypeDef *hNand,
 			      NAND_AddressTypeDef *Address);
+void NAND_Init_Bad_Block_Table(NAND_HandleTypeDef *hNand);
+uint32_t NAND_Get_Block_Status(NAND_HandleTypeDef *hNand, uint32_t block);
 Std_ReturnType NAND_Address_Inc(NAND_HandleTypeDef *hNand,
 				NAND_AddressTypeDef *Address,
 				uint32_t numPagesRead);
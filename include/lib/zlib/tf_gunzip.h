@@ -12,5 +12,7 @@
 
 int gunzip(uintptr_t *in_buf, size_t in_len, uintptr_t *out_buf,
 	   size_t out_len, uintptr_t work_buf, size_t work_len);
+int gunzip_stream(uintptr_t in_handle, size_t in_len, uintptr_t *out_buf,
+		  size_t out_len, uintptr_t work_buf, size_t work_len);
 
 #endif /* __TF_GUNZIP_H___ */
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2020, STMicroelectronics - All Rights Reserved
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef STM32IMAGE_CHECKSUM_H
+#define STM32IMAGE_CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Number of words summed in 16-bit lanes before folding them: each word adds
+ * at most 2 * 0xFF to a lane, so 128 words can't overflow 0xFFFF.
+ */
+#define STM32IMAGE_CHECKSUM_FOLD_WORDS	128U
+
+/* Sum nb_words aligned words in 16-bit lanes, then fold the lanes */
+static inline uint32_t stm32image_checksum_words(const uint32_t *word,
+						 size_t nb_words)
+{
+	uint32_t lanes = 0U;
+	size_t i;
+
+	for (i = 0U; i < nb_words; i++) {
+		lanes += word[i] & 0x00FF00FFU;
+		lanes += (word[i] >> 8) & 0x00FF00FFU;
+	}
+
+	return (lanes & 0xFFFFU) + (lanes >> 16);
+}
+
+/*
+ * Return the sum of all bytes of the buffer, as stored in the payload_checksum
+ * field of an STM32 image header. Aligned words are summed in 16-bit lanes,
+ * which is endianness agnostic. Shared by BL2 and the stm32image tool.
+ */
+static inline uint32_t stm32image_payload_checksum(const uint8_t *buf,
+						   size_t len)
+{
+	const size_t fold_len = STM32IMAGE_CHECKSUM_FOLD_WORDS *
+				sizeof(uint32_t);
+	uint32_t csum = 0U;
+
+	while ((len != 0U) &&
+	       (((uintptr_t)buf & (sizeof(uint32_t) - 1U)) != 0U)) {
+		csum += *buf++;
+		len--;
+	}
+
+	/* Constant trip count, so that compilers can vectorize it */
+	while (len >= fold_len) {
+		csum += stm32image_checksum_words((const uint32_t *)buf,
+						  STM32IMAGE_CHECKSUM_FOLD_WORDS);
+		buf += fold_len;
+		len -= fold_len;
+	}
+
+	csum += stm32image_checksum_words((const uint32_t *)buf,
+					  len / sizeof(uint32_t));
+	buf += len & ~(sizeof(uint32_t) - 1U);
+	len &= sizeof(uint32_t) - 1U;
+
+	while (len != 0U) {
+		csum += *buf++;
+		len--;
+	}
+
+	return csum;
+}
+
+#endif /* STM32IMAGE_CHECKSUM_H */
@@ -5,7 +5,59 @@
  */
 
 #include <stddef.h>
+#include <stdint.h>
 
+#include "memops_private.h"
+
+#if LIBC_OPTIMIZED_MEMOPS
+/*
+ * When source and destination share the same alignment, copy the bulk of the
+ * data by naturally aligned words, four at a time, with byte-wise head and
+ * tail. Other copies use the byte loop, as unaligned accesses are not allowed
+ * in TF-A.
+ */
+void *memcpy(void *dst, const void *src, size_t len)
+{
+	const char *s = src;
+	char *d = dst;
+
+	if (words_coaligned(d, s)) {
+		const word_t *ws;
+		word_t *wd;
+
+		while ((len != 0U) && !word_aligned(d)) {
+			*d++ = *s++;
+			len--;
+		}
+
+		ws = (const word_t *)s;
+		wd = (word_t *)d;
+
+		while (len >= (4U * sizeof(word_t))) {
+			wd[0] = ws[0];
+			wd[1] = ws[1];
+			wd[2] = ws[2];
+			wd[3] = ws[3];
+			wd += 4;
+			ws += 4;
+			len -= 4U * sizeof(word_t);
+		}
+
+		while (len >= sizeof(word_t)) {
+			*wd++ = *ws++;
+			len -= sizeof(word_t);
+		}
+
+		s = (const char *)ws;
+		d = (char *)wd;
+	}
+
+	while (len--)
+		*d++ = *s++;
+
+	return dst;
+}
+#else
 void *memcpy(void *dst, const void *src, size_t len)
 {
 	const char *s = src;
@@ -16,3 +68,4 @@ void *memcpy(void *dst, const void *src, size_t len)
 
 	return dst;
 }
+#endif /* LIBC_OPTIMIZED_MEMOPS */
@@ -4,8 +4,11 @@
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
+#include <stdint.h>
 #include <string.h>
 
+#include "memops_private.h"
+
 void *memmove(void *dst, const void *src, size_t len)
 {
 	/*
@@ -24,6 +27,24 @@ void *memmove(void *dst, const void *src, size_t len)
 		const char *end = dst;
 		const char *s = (const char *)src + len;
 		char *d = (char *)dst + len;
+#if LIBC_OPTIMIZED_MEMOPS
+		/* ...by aligned words when possible, see memcpy() */
+		if (words_coaligned(d, s)) {
+			const word_t *ws;
+			word_t *wd;
+
+			while ((d != end) && !word_aligned(d))
+				*--d = *--s;
+
+			ws = (const word_t *)s;
+			wd = (word_t *)d;
+			while ((size_t)((char *)wd - end) >= sizeof(word_t))
+				*--wd = *--ws;
+
+			s = (const char *)ws;
+			d = (char *)wd;
+		}
+#endif
 		while (d != end)
 			*--d = *--s;
 	}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2018, ARM Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef MEMOPS_PRIVATE_H
+#define MEMOPS_PRIVATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Helpers of the LIBC_OPTIMIZED_MEMOPS variants of memcpy(), memmove() and
+ * memset(), which access memory by naturally aligned words. The word type
+ * follows uintptr_t, and may alias objects of any type.
+ */
+typedef uintptr_t __attribute__((__may_alias__)) word_t;
+
+#define WORD_MASK	(sizeof(word_t) - 1U)
+
+static inline bool word_aligned(const void *ptr)
+{
+	return ((uintptr_t)ptr & WORD_MASK) == 0U;
+}
+
+/*
+ * Two buffers can be accessed by aligned words together when they have the
+ * same offset from a word boundary: unaligned accesses are not allowed in
+ * TF-A.
+ */
+static inline bool words_coaligned(const void *ptr1, const void *ptr2)
+{
+	return (((uintptr_t)ptr1 ^ (uintptr_t)ptr2) & WORD_MASK) == 0U;
+}
+
+/* Word with all its bytes set to val */
+static inline word_t word_pattern(int val)
+{
+	return (word_t)(unsigned char)val * (UINTPTR_MAX / 0xFFU);
+}
+
+#endif /* MEMOPS_PRIVATE_H */
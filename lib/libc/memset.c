@@ -5,7 +5,47 @@
  */
 
 #include <stddef.h>
+#include <stdint.h>
 
+#include "memops_private.h"
+
+#if LIBC_OPTIMIZED_MEMOPS
+/* Fill by naturally aligned words, four at a time, with byte-wise head/tail */
+void *memset(void *dst, int val, size_t count)
+{
+	char *ptr = dst;
+	word_t *wptr;
+	word_t pattern = word_pattern(val);
+
+	while ((count != 0U) && !word_aligned(ptr)) {
+		*ptr++ = val;
+		count--;
+	}
+
+	wptr = (word_t *)ptr;
+
+	while (count >= (4U * sizeof(word_t))) {
+		wptr[0] = pattern;
+		wptr[1] = pattern;
+		wptr[2] = pattern;
+		wptr[3] = pattern;
+		wptr += 4;
+		count -= 4U * sizeof(word_t);
+	}
+
+	while (count >= sizeof(word_t)) {
+		*wptr++ = pattern;
+		count -= sizeof(word_t);
+	}
+
+	ptr = (char *)wptr;
+
+	while (count--)
+		*ptr++ = val;
+
+	return dst;
+}
+#else
 void *memset(void *dst, int val, size_t count)
 {
 	char *ptr = dst;
@@ -15,3 +55,4 @@ void *memset(void *dst, int val, size_t count)
 
 	return dst;
 }
+#endif /* LIBC_OPTIMIZED_MEMOPS */
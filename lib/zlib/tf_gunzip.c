@@ -7,6 +7,7 @@
 #include <assert.h>
 #include <debug.h>
 #include <errno.h>
+#include <io_storage.h>
 #include <string.h>
 #include <tf_gunzip.h>
 #include <utils.h>
@@ -18,6 +19,9 @@
  */
 #define ZALLOC_ALIGNMENT	sizeof(void *)
 
+/* Size of the compressed data read from storage at a time by gunzip_stream() */
+#define GUNZIP_STREAM_CHUNK_SIZE	0x4000U
+
 static uintptr_t zalloc_start;
 static uintptr_t zalloc_end;
 static uintptr_t zalloc_current;
@@ -99,3 +103,87 @@ int gunzip(uintptr_t *in_buf, size_t in_len, uintptr_t *out_buf,
 
 	return ret;
 }
+
+/*
+ * gunzip_stream - decompress gzip data read from storage
+ * @in_handle: IO handle of the compressed input, at the start of the data
+ * @in_len: length of the compressed input
+ * @out_buf: destination of decompressed output. Upon exit, the end of output.
+ * @out_len: length of out_buf
+ * @work_buf: workspace, holding the input chunk buffer and inflate state
+ * @work_len: length of workspace
+ *
+ * Unlike gunzip(), the compressed data never needs to be in memory as a
+ * whole: it is read in chunks, each inflated before the next one is read.
+ */
+int gunzip_stream(uintptr_t in_handle, size_t in_len, uintptr_t *out_buf,
+		  size_t out_len, uintptr_t work_buf, size_t work_len)
+{
+	z_stream stream;
+	uintptr_t chunk_buf = work_buf;
+	size_t chunk_len, bytes_read;
+	int zret, ret;
+
+	if (work_len <= GUNZIP_STREAM_CHUNK_SIZE) {
+		ERROR("zlib: workspace too small for streaming\n");
+		return -ENOMEM;
+	}
+
+	zalloc_start = work_buf + GUNZIP_STREAM_CHUNK_SIZE;
+	zalloc_end = work_buf + work_len;
+	zalloc_current = zalloc_start;
+
+	stream.next_in = Z_NULL;
+	stream.avail_in = 0;
+	stream.next_out = (typeof(stream.next_out))*out_buf;
+	stream.avail_out = out_len;
+	stream.zalloc = zcalloc;
+	stream.zfree = zfree;
+	stream.opaque = (voidpf)0;
+
+	zret = inflateInit(&stream);
+	if (zret != Z_OK) {
+		ERROR("zlib: inflate init failed (ret = %d)\n", zret);
+		return (zret == Z_MEM_ERROR) ? -ENOMEM : -EIO;
+	}
+
+	do {
+		if ((stream.avail_in == 0U) && (in_len != 0U)) {
+			chunk_len = MIN(in_len, (size_t)GUNZIP_STREAM_CHUNK_SIZE);
+
+			ret = io_read(in_handle, chunk_buf, chunk_len,
+				      &bytes_read);
+			if ((ret != 0) || (bytes_read != chunk_len)) {
+				ERROR("zlib: failed to read input (ret = %d)\n",
+				      ret);
+				ret = -EIO;
+				goto out;
+			}
+
+			stream.next_in = (typeof(stream.next_in))chunk_buf;
+			stream.avail_in = chunk_len;
+			in_len -= chunk_len;
+		}
+
+		zret = inflate(&stream, Z_NO_FLUSH);
+	} while (zret == Z_OK);
+
+	if (zret == Z_STREAM_END) {
+		ret = 0;
+	} else {
+		if (stream.msg)
+			ERROR("%s\n", stream.msg);
+		ERROR("zlib: inflate failed (ret = %d)\n", zret);
+		ret = (zret == Z_MEM_ERROR) ? -ENOMEM : -EIO;
+	}
+
+	VERBOSE("zlib: %lu byte input\n", stream.total_in);
+	VERBOSE("zlib: %lu byte output\n", stream.total_out);
+
+out:
+	*out_buf = (uintptr_t)stream.next_out;
+
+	inflateEnd(&stream);
+
+	return ret;
+}
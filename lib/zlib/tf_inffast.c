@@ -0,0 +1,335 @@
+/*
+ * Copyright (c) 2020, ARM Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Derived from inffast.c of zlib 1.2.11, Copyright (C) 1995-2017 Mark Adler.
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ */
+
+#include <string.h>
+
+#include "zutil.h"
+#include "inftrees.h"
+#include "inflate.h"
+#include "inffast.h"
+
+/*
+ * Drop-in replacement for inflate_fast(), built instead of inffast.c when
+ * ZLIB_FAST_INFLATE=1. It has the same entry assumptions and return states,
+ * see inffast.c. The differences are:
+ *
+ * - When the bit buffer is 64-bit wide and holds less than 48 bits, which is
+ *   what a whole length/distance pair needs, it is refilled once per code to
+ *   56 bits from the next 8 input bytes, or byte by byte to 48 bits near the
+ *   end of the input. No refill check is needed while decoding, and up to
+ *   three literals are emitted per refill. Input is still read byte by byte,
+ *   as TF-A images are built with strict alignment checking.
+ * - Matches are copied with memcpy() and memset(): overlapping matches are
+ *   expanded by doubling the copied pattern, and distance 1 runs (e.g. zero
+ *   filled areas of an image) become a single memset().
+ */
+
+#define HOLD_BITS		(sizeof(unsigned long) * 8U)
+#define WIDE_HOLD		(HOLD_BITS >= 64U)
+
+/* Bits needed for a length/distance pair: 15 + 5 + 15 + 13 */
+#define MAX_PAIR_BITS		48U
+
+/* Matches shorter than this are copied byte by byte */
+#define COPY_MIN_LEN		16U
+
+/*
+ * Bits above the count may already hold the next input bytes (see
+ * refill()), so new bytes are or-ed in: the result is the same.
+ */
+#define PULL_BYTE()						\
+	do {							\
+		hold |= (unsigned long)(*in++) << bits;		\
+		bits += 8U;					\
+	} while (0)
+
+/* Make sure n bits are available, only needed with a 32-bit hold */
+#define NEED_BITS(n)						\
+	do {							\
+		if (!WIDE_HOLD) {				\
+			while (bits < (n)) {			\
+				PULL_BYTE();			\
+			}					\
+		}						\
+	} while (0)
+
+/*
+ * Fill a 64-bit hold to at least 56 bits from the next 8 input bytes. They
+ * are assembled byte by byte, which compilers turn into a single load where
+ * unaligned accesses are allowed. Bytes that don't fit are also or-ed into
+ * the top of hold, and will be or-ed at the same place by the next refill.
+ */
+static inline unsigned long refill(unsigned long hold, unsigned int bits,
+				   z_const unsigned char FAR *in)
+{
+	unsigned long long next;
+
+	next = (unsigned long long)in[0] |
+	       ((unsigned long long)in[1] << 8) |
+	       ((unsigned long long)in[2] << 16) |
+	       ((unsigned long long)in[3] << 24) |
+	       ((unsigned long long)in[4] << 32) |
+	       ((unsigned long long)in[5] << 40) |
+	       ((unsigned long long)in[6] << 48) |
+	       ((unsigned long long)in[7] << 56);
+
+	return hold | (unsigned long)(next << bits);
+}
+
+/* Copy a match from earlier output, which may overlap the destination */
+static inline unsigned char FAR *copy_match(unsigned char FAR *out,
+					    unsigned int dist,
+					    unsigned int len)
+{
+	const unsigned char FAR *from = out - dist;
+	unsigned int chunk = dist;
+
+	if (len < COPY_MIN_LEN) {
+		do {
+			*out++ = *from++;
+		} while (--len != 0U);
+
+		return out;
+	}
+
+	if (dist == 1U) {
+		memset(out, *from, len);
+
+		return out + len;
+	}
+
+	/* The pattern repeats every dist bytes, copy it doubling each time */
+	while (len > chunk) {
+		memcpy(out, from, chunk);
+		out += chunk;
+		len -= chunk;
+		chunk += chunk;
+	}
+
+	memcpy(out, from, len);
+
+	return out + len;
+}
+
+void ZLIB_INTERNAL inflate_fast(z_streamp strm, unsigned start)
+{
+	struct inflate_state FAR *state;
+	z_const unsigned char FAR *in;	/* local strm->next_in */
+	z_const unsigned char FAR *last; /* have enough input while in < last */
+	z_const unsigned char FAR *last8; /* can read 8 bytes while < last8 */
+	unsigned char FAR *out;		/* local strm->next_out */
+	unsigned char FAR *beg;		/* inflate()'s initial strm->next_out */
+	unsigned char FAR *end;		/* while out < end, enough space */
+#ifdef INFLATE_STRICT
+	unsigned int dmax;		/* maximum distance from zlib header */
+#endif
+	unsigned int wsize;		/* window size or zero if no window */
+	unsigned int whave;		/* valid bytes in the window */
+	unsigned int wnext;		/* window write index */
+	unsigned char FAR *window;	/* allocated sliding window */
+	unsigned long hold;		/* local strm->hold */
+	unsigned int bits;		/* local strm->bits */
+	code const FAR *lcode;		/* local strm->lencode */
+	code const FAR *dcode;		/* local strm->distcode */
+	unsigned int lmask;		/* mask for 1st level of length codes */
+	unsigned int dmask;		/* mask for 1st level of dist codes */
+	code here;			/* retrieved table entry */
+	unsigned int op;		/* code bits, operation, extra bits */
+	unsigned int len;		/* match length, unused bytes */
+	unsigned int dist;		/* match distance */
+	unsigned char FAR *from;	/* where to copy match from */
+	char *too_far_msg = (char *)"invalid distance too far back";
+
+	/* copy state to local variables */
+	state = (struct inflate_state FAR *)strm->state;
+	in = strm->next_in;
+	last = in + (strm->avail_in - 5);
+	last8 = (strm->avail_in >= 8U) ? in + (strm->avail_in - 7U) : in;
+	out = strm->next_out;
+	beg = out - (start - strm->avail_out);
+	end = out + (strm->avail_out - 257);
+#ifdef INFLATE_STRICT
+	dmax = state->dmax;
+#endif
+	wsize = state->wsize;
+	whave = state->whave;
+	wnext = state->wnext;
+	window = state->window;
+	hold = state->hold;
+	bits = state->bits;
+	lcode = state->lencode;
+	dcode = state->distcode;
+	lmask = (1U << state->lenbits) - 1U;
+	dmask = (1U << state->distbits) - 1U;
+
+	/*
+	 * Decode literals and length/distances until end-of-block or not
+	 * enough input data or output space. While in < last, at least six
+	 * input bytes are left, which is what a refill to 48 bits consumes at
+	 * most.
+	 */
+	do {
+		if (WIDE_HOLD) {
+			if (bits < MAX_PAIR_BITS) {
+				if (in < last8) {
+					hold = refill(hold, bits, in);
+					in += (63U - bits) >> 3;
+					bits |= 56U;
+				} else {
+					do {
+						PULL_BYTE();
+					} while (bits < MAX_PAIR_BITS);
+				}
+			}
+		} else if (bits < 15U) {
+			PULL_BYTE();
+			PULL_BYTE();
+		}
+
+		here = lcode[hold & lmask];
+dolen:
+		op = (unsigned int)here.bits;
+		hold >>= op;
+		bits -= op;
+		op = (unsigned int)here.op;
+		if (op == 0U) {				/* literal */
+			*out++ = (unsigned char)here.val;
+
+			/* Each literal uses 15 bits at most */
+			if (WIDE_HOLD) {
+				here = lcode[hold & lmask];
+				if (here.op != 0U) {
+					continue;
+				}
+
+				hold >>= here.bits;
+				bits -= here.bits;
+				*out++ = (unsigned char)here.val;
+
+				here = lcode[hold & lmask];
+				if (here.op != 0U) {
+					continue;
+				}
+
+				hold >>= here.bits;
+				bits -= here.bits;
+				*out++ = (unsigned char)here.val;
+			}
+		} else if ((op & 16U) != 0U) {		/* length base */
+			len = (unsigned int)here.val;
+			op &= 15U;		/* number of extra bits */
+			if (op != 0U) {
+				NEED_BITS(op);
+				len += (unsigned int)hold & ((1U << op) - 1U);
+				hold >>= op;
+				bits -= op;
+			}
+
+			NEED_BITS(15U);
+			here = dcode[hold & dmask];
+dodist:
+			op = (unsigned int)here.bits;
+			hold >>= op;
+			bits -= op;
+			op = (unsigned int)here.op;
+			if ((op & 16U) != 0U) {		/* distance base */
+				dist = (unsigned int)here.val;
+				op &= 15U;	/* number of extra bits */
+				NEED_BITS(op);
+				dist += (unsigned int)hold & ((1U << op) - 1U);
+#ifdef INFLATE_STRICT
+				if (dist > dmax) {
+					strm->msg = too_far_msg;
+					state->mode = BAD;
+					break;
+				}
+#endif
+				hold >>= op;
+				bits -= op;
+
+				op = (unsigned int)(out - beg);
+				if (dist <= op) {
+					/* copy direct from output */
+					out = copy_match(out, dist, len);
+					continue;
+				}
+
+				/* copy from window */
+				op = dist - op;	/* distance back in window */
+				if ((op > whave) && (state->sane != 0)) {
+					strm->msg = too_far_msg;
+					state->mode = BAD;
+					break;
+				}
+
+				from = window;
+				if (wnext == 0U) {	/* very common case */
+					from += wsize - op;
+				} else if (wnext < op) { /* wrap around */
+					from += wsize + wnext - op;
+					op -= wnext;
+					/* some from end of window */
+					if (op < len) {
+						memcpy(out, from, op);
+						out += op;
+						len -= op;
+						from = window;
+						op = wnext;
+					}
+				} else {		/* contiguous */
+					from += wnext - op;
+				}
+
+				if (op < len) {		/* rest from output */
+					memcpy(out, from, op);
+					out += op;
+					len -= op;
+					out = copy_match(out, dist, len);
+				} else {
+					memcpy(out, from, len);
+					out += len;
+				}
+			} else if ((op & 64U) == 0U) {	/* 2nd level code */
+				here = dcode[here.val +
+					     (hold & ((1U << op) - 1U))];
+				goto dodist;
+			} else {
+				strm->msg = (char *)"invalid distance code";
+				state->mode = BAD;
+				break;
+			}
+		} else if ((op & 64U) == 0U) {		/* 2nd level code */
+			here = lcode[here.val + (hold & ((1U << op) - 1U))];
+			goto dolen;
+		} else if ((op & 32U) != 0U) {		/* end-of-block */
+			state->mode = TYPE;
+			break;
+		} else {
+			strm->msg = (char *)"invalid literal/length code";
+			state->mode = BAD;
+			break;
+		}
+	} while ((in < last) && (out < end));
+
+	/* return unused bytes, that were all read by this call */
+	len = bits >> 3;
+	in -= len;
+	bits -= len << 3;
+	hold &= (1UL << bits) - 1UL;
+
+	/* update state and return */
+	strm->next_in = in;
+	strm->next_out = out;
+	strm->avail_in = (unsigned)(in < last ?
+				    5 + (last - in) : 5 - (in - last));
+	strm->avail_out = (unsigned)(out < end ?
+				     257 + (end - out) : 257 - (out - end));
+	state->hold = hold;
+	state->bits = bits;
+}
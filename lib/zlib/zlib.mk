@@ -10,7 +10,6 @@ ZLIB_PATH	:=	lib/zlib
 ZLIB_SOURCES	:=	$(addprefix $(ZLIB_PATH)/,	\
 					adler32.c	\
 					crc32.c		\
-					inffast.c	\
 					inflate.c	\
 					inftrees.c	\
 					zutil.c)
@@ -19,6 +18,12 @@ ZLIB_SOURCES	:=	$(addprefix $(ZLIB_PATH)/,	\
 ZLIB_SOURCES	+=	$(addprefix $(ZLIB_PATH)/,	\
 					tf_gunzip.c)
 
+ifeq (${ZLIB_FAST_INFLATE},1)
+ZLIB_SOURCES	+=	$(ZLIB_PATH)/tf_inffast.c
+else
+ZLIB_SOURCES	+=	$(ZLIB_PATH)/inffast.c
+endif
+
 INCLUDES	+=	-Iinclude/lib/zlib
 
 # REVISIT: the following flags need not be given globally
@@ -112,9 +112,16 @@ HANDLE_EA_EL3_FIRST		:= 0
 # operations.
 HW_ASSISTED_COHERENCY		:= 0
 
+# Inflate compressed images while they are read from storage, instead of
+# staging them in a buffer first
+IMAGE_DECOMPRESS_STREAM		:= 0
+
 # Set the default algorithm for the generation of Trusted Board Boot keys
 KEY_ALG				:= rsa
 
+# Use word-wise implementations of memcpy(), memmove() and memset() in libc
+LIBC_OPTIMIZED_MEMOPS		:= 0
+
 # Enable use of the console API allowing multiple consoles to be registered
 # at the same time.
 MULTI_CONSOLE_API		:= 0
@@ -183,6 +190,9 @@ V				:= 0
 # platforms).
 WARMBOOT_ENABLE_DCACHE_EARLY	:= 0
 
+# Build the TF-A tuned inflate_fast() instead of the one imported from zlib
+ZLIB_FAST_INFLATE		:= 0
+
 # Build option to enable/disable the Statistical Profiling Extensions
 ENABLE_SPE_FOR_LOWER_ELS	:= 1
 
@@ -128,10 +128,16 @@ bl_params_t *plat_get_next_bl_params(void)
 void bl2_plat_preload_setup(void)
 {
 #ifdef UNIPHIER_DECOMPRESS_GZIP
+#if IMAGE_DECOMPRESS_STREAM
+	image_decompress_stream_init(UNIPHIER_IMAGE_BUF_BASE,
+				     UNIPHIER_IMAGE_BUF_SIZE,
+				     gunzip_stream);
+#else
 	image_decompress_init(UNIPHIER_IMAGE_BUF_BASE,
 			      UNIPHIER_IMAGE_BUF_SIZE,
 			      gunzip);
 #endif
+#endif
 }
 
 int bl2_plat_handle_pre_image_load(unsigned int image_id)
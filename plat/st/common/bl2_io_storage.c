@@ -60,6 +60,12 @@ static io_block_spec_t gpt_block_spec = {
 
 static uint32_t block_buffer[MMC_BLOCK_SIZE] __aligned(MMC_BLOCK_SIZE);
 
+/* MBR, GPT header and first GPT entries fit in a single cache line */
+#define MMC_CACHE_LINE_SIZE	(4U * MMC_BLOCK_SIZE)
+
+static uint8_t block_cache[PLAT_IO_BLOCK_CACHE_LINES * MMC_CACHE_LINE_SIZE]
+	__aligned(MMC_BLOCK_SIZE);
+
 static const io_block_dev_spec_t mmc_block_dev_spec = {
 	/* It's used as temp buffer in block driver */
 	.buffer = {
@@ -71,7 +77,26 @@ static const io_block_dev_spec_t mmc_block_dev_spec = {
 		.write = NULL,
 	},
 	.block_size = MMC_BLOCK_SIZE,
+	.cache = {
+		.offset = (size_t)&block_cache,
+		.length = sizeof(block_cache),
+	},
 };
+
+/* STM32 images are loaded by asynchronous reads, see io_stm32image */
+static struct mmc_read_req mmc_image_read_req;
+
+static int mmc_image_read_start(uintptr_t offset, uintptr_t buffer,
+				size_t length)
+{
+	return mmc_read_blocks_start(&mmc_image_read_req,
+				     offset / MMC_BLOCK_SIZE, buffer, length);
+}
+
+static size_t mmc_image_read_wait(void)
+{
+	return mmc_read_blocks_wait(&mmc_image_read_req);
+}
 #endif
 
 static uintptr_t storage_dev_handle;
@@ -304,6 +329,14 @@ static void print_boot_device(boot_api_context_t *boot_context)
 }
 
 #if STM32MP_EMMC || STM32MP_SDMMC
+static void stm32mp_io_print_block_cache_stats(void)
+{
+	io_block_cache_stats_t stats;
+
+	io_block_get_cache_stats(&stats);
+	INFO("Block cache: %u hits, %u misses\n", stats.hits, stats.misses);
+}
+
 static void boot_mmc(enum mmc_device_type mmc_dev_type,
 		     uint16_t boot_interface_instance)
 {
@@ -364,6 +397,8 @@ static void boot_mmc(enum mmc_device_type mmc_dev_type,
 	io_result = io_dev_close(storage_dev_handle);
 	assert(io_result == 0);
 
+	stm32mp_io_print_block_cache_stats();
+
 	stm32image_dev_info_spec.device_size =
 		stm32_sdmmc2_mmc_get_device_size();
 
@@ -379,6 +414,9 @@ static void boot_mmc(enum mmc_device_type mmc_dev_type,
 		part->bkp_offset = 0U;
 	}
 
+	stm32image_dev_info_spec.read_start = mmc_image_read_start;
+	stm32image_dev_info_spec.read_wait = mmc_image_read_wait;
+
 	/*
 	 * Re-open MMC with io_mmc, for better perfs compared to
 	 * io_block.
@@ -424,6 +462,7 @@ static void boot_qspi_nor(boot_api_context_t *boot_context)
 
 	stm32image_dev_info_spec.device_size = QSPI_NOR_MAX_SIZE;
 	stm32image_dev_info_spec.lba_size = QSPI_NOR_LBA_SIZE;
+	stm32image_dev_info_spec.byte_access = true;
 
 	idx = IMG_IDX_BL33;
 	part = &stm32image_dev_info_spec.part_info[idx];
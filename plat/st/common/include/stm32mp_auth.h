@@ -8,6 +8,7 @@
 #define STM32MP_AUTH_H
 
 #include <boot_api.h>
+#include <stdbool.h>
 
 struct auth_ops {
 	uint32_t (*check_key)(uint8_t *p_pub_key_in,
@@ -20,4 +21,11 @@ void stm32mp_init_auth(struct auth_ops *init_ptr);
 int check_header(boot_api_image_header_t *header, uintptr_t buffer);
 int check_authentication(boot_api_image_header_t *header, uintptr_t buffer);
 
+int stm32mp_check_image_start(boot_api_image_header_t *header,
+			      bool authenticate, uint32_t image_id,
+			      uintptr_t offset);
+int stm32mp_check_image_update(uintptr_t buffer, size_t length);
+int stm32mp_check_image_checksum(void);
+int stm32mp_check_image_signature(void);
+
 #endif /* STM32MP_AUTH_H */
@@ -4,13 +4,22 @@
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
+#include <assert.h>
+#include <bsec.h>
 #include <debug.h>
 #include <errno.h>
 #include <hash_sec.h>
 #include <io_storage.h>
+#include <limits.h>
 #include <platform_def.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stm32mp_auth.h>
 #include <stm32mp_common.h>
+#include <stm32mp1_context.h>
+#include <stm32image_checksum.h>
+#include <string.h>
+#include <utils.h>
 
 static const struct auth_ops *stm32mp_auth_ops;
 
@@ -25,17 +34,8 @@ void stm32mp_init_auth(struct auth_ops *init_ptr)
 	stm32mp_auth_ops = init_ptr;
 }
 
-int check_header(boot_api_image_header_t *header, uintptr_t buffer)
+static int check_header_fields(boot_api_image_header_t *header)
 {
-	uint32_t i;
-	uint32_t img_checksum = 0;
-
-	/*
-	 * Check header/payload validity:
-	 *	- Header magic
-	 *	- Header version
-	 *	- Payload checksum
-	 */
 	if (header->magic != BOOT_API_IMAGE_HEADER_MAGIC_NB) {
 		ERROR("Header magic is not correct\n");
 		return -EINVAL;
@@ -46,10 +46,17 @@ int check_header(boot_api_image_header_t *header, uintptr_t buffer)
 		return -EINVAL;
 	}
 
-	for (i = 0; i < header->image_length; i++) {
-		img_checksum += *(uint8_t *)(buffer + i);
-	}
+	return 0;
+}
+
+static uint32_t payload_checksum(uintptr_t buffer, size_t length)
+{
+	return stm32image_payload_checksum((const uint8_t *)buffer, length);
+}
 
+static int check_payload_checksum(boot_api_image_header_t *header,
+				  uint32_t img_checksum)
+{
 	if (header->payload_checksum != img_checksum) {
 		ERROR("Payload checksum is not correct:\n");
 		ERROR("  Computed: 0x%x (awaited: 0x%x)\n", img_checksum,
@@ -60,11 +67,15 @@ int check_header(boot_api_image_header_t *header, uintptr_t buffer)
 	return 0;
 }
 
-int check_authentication(boot_api_image_header_t *header, uintptr_t buffer)
+/*
+ * Check the image key and start its hash with the end of the header.
+ * Return 1 if the signature check is skipped, 0 if the payload has to be
+ * hashed, or a negative error code.
+ */
+static int auth_start(boot_api_image_header_t *header,
+		      HASH_HandleTypeDef *hhash)
 {
 	uint32_t sec_closed, uret;
-	HASH_HandleTypeDef hhash;
-	uint8_t image_hash[BOOT_API_SHA256_DIGEST_SIZE_IN_BYTES];
 	uint32_t header_skip_cksum = sizeof(header->magic) +
 		sizeof(header->image_signature) +
 		sizeof(header->payload_checksum);
@@ -79,7 +90,7 @@ int check_authentication(boot_api_image_header_t *header, uintptr_t buffer)
 	if ((sec_closed & BIT(BOOT_API_OTP_MODE_CLOSED_BIT_POS)) == 0U) {
 		if (header->option_flags != 0U) {
 			WARN("Skip signature check (header option)\n");
-			return 0;
+			return 1;
 		}
 		INFO("Check signature on Non-Full-Secured platform\n");
 	}
@@ -90,13 +101,13 @@ int check_authentication(boot_api_image_header_t *header, uintptr_t buffer)
 	}
 
 	/* Compute end of header hash and payload hash */
-	uret = HASH_SHA256_Init(&hhash);
+	uret = HASH_SHA256_Init(hhash);
 	if (uret != STD_OK) {
 		ERROR("Hash init failed\n");
 		return -EBUSY;
 	}
 
-	uret = HASH_SHA256_Accumulate(&hhash,
+	uret = HASH_SHA256_Accumulate(hhash,
 				      (uint8_t *)&header->header_version,
 				      sizeof(boot_api_image_header_t) -
 				      header_skip_cksum);
@@ -105,20 +116,24 @@ int check_authentication(boot_api_image_header_t *header, uintptr_t buffer)
 		return -EINVAL;
 	}
 
-	uret = HASH_SHA256_Start(&hhash, (uint8_t *)buffer,
-				 header->image_length, image_hash,
-				 HASH_TIMEOUT_VALUE);
-	if (uret != STD_OK) {
-		ERROR("Hash of payload failed\n");
-		return -EINVAL;
-	}
+	return 0;
+}
+
+static int auth_hash_finish(HASH_HandleTypeDef *hhash, uint8_t *image_hash)
+{
+	uint32_t uret;
 
-	uret = HASH_SHA256_Finish(&hhash, image_hash, HASH_TIMEOUT_VALUE);
+	uret = HASH_SHA256_Finish(hhash, image_hash, HASH_TIMEOUT_VALUE);
 	if (uret != STD_OK) {
 		ERROR("Hash of payload failed\n");
 		return -EINVAL;
 	}
 
+	return 0;
+}
+
+static int auth_verify(boot_api_image_header_t *header, uint8_t *image_hash)
+{
 	/* Verify signature */
 	if (stm32mp_auth_ops->verify_signature
 	    (image_hash, header->ecc_pubk,
@@ -130,3 +145,435 @@ int check_authentication(boot_api_image_header_t *header, uintptr_t buffer)
 	return 0;
 }
 
+#if STM32MP_AUTH_CACHE
+/*
+ * Verified image cache: once the signature of an image loaded from a boot
+ * device has been checked, an entry is kept in Backup SRAM, which is secure
+ * and retained across warm boots. On the next boot, the image is still fully
+ * hashed, but the ECDSA verification is skipped if its digest, signature,
+ * location and the monotonic counter are the same as in the entry.
+ *
+ * Each entry is authenticated with an HMAC-SHA256 tag, keyed with a 256-bit
+ * device secret read from the upper OTP area. The tag also covers the image
+ * signature, and the public key is covered by the digest: it is still checked
+ * against its OTP hash in auth_start(). Entries that don't match their tag
+ * are ignored, and the cache is not used if the key is not provisioned.
+ */
+#define AUTH_CACHE_ENTRIES		4U
+#define AUTH_CACHE_KEY_WORDS		8U
+#define AUTH_CACHE_VALID		U(0x43414348)	/* "CACH" */
+#define HMAC_IPAD			U(0x36)
+#define HMAC_OPAD			U(0x5C)
+
+struct auth_cache_entry {
+	uint32_t valid;
+	uint32_t image_id;	/* Binary type */
+	uint32_t location;	/* Boot interface and instance */
+	uint32_t offset;	/* Image offset in the device */
+	uint32_t nv_counter;	/* Monotonic counter OTP */
+	uint8_t digest[BOOT_API_SHA256_DIGEST_SIZE_IN_BYTES];
+	uint8_t tag[BOOT_API_SHA256_DIGEST_SIZE_IN_BYTES];
+};
+
+static struct auth_cache_entry auth_cache[AUTH_CACHE_ENTRIES];
+static bool auth_cache_loaded;
+static bool auth_cache_disabled;
+
+static int auth_cache_get_key(uint32_t *key)
+{
+	uint32_t otp, len, i;
+	uint32_t any = 0U;
+
+	if (auth_cache_disabled) {
+		return -ENOENT;
+	}
+
+	if ((stm32_get_otp_index(AUTH_CACHE_KEY_OTP, &otp, &len) != 0) ||
+	    (len != (AUTH_CACHE_KEY_WORDS * sizeof(uint32_t) * CHAR_BIT)) ||
+	    (otp < STM32MP1_UPPER_OTP_START) ||
+	    ((otp + AUTH_CACHE_KEY_WORDS) > OTP_MAX_SIZE)) {
+		goto disable;
+	}
+
+	for (i = 0U; i < AUTH_CACHE_KEY_WORDS; i++) {
+		if (bsec_shadow_read_otp(&key[i], otp + i) != BSEC_OK) {
+			goto disable;
+		}
+
+		any |= key[i];
+	}
+
+	if (any != 0U) {
+		return 0;
+	}
+
+disable:
+	WARN("Verified image cache key not available\n");
+	zeromem(key, AUTH_CACHE_KEY_WORDS * sizeof(uint32_t));
+	auth_cache_disabled = true;
+
+	return -ENOENT;
+}
+
+/* Compute the HMAC of an entry and of the signature of its image */
+static int auth_cache_mac(const struct auth_cache_entry *entry,
+			  const uint8_t *signature, uint8_t *tag)
+{
+	HASH_HandleTypeDef hhash;
+	uint32_t key[AUTH_CACHE_KEY_WORDS];
+	uint8_t pad[HASH_BLOCK_SIZE_NB_BYTES] __aligned(4);
+	uint8_t inner[BOOT_API_SHA256_DIGEST_SIZE_IN_BYTES] __aligned(4);
+	const uint8_t *key_bytes = (const uint8_t *)key;
+	unsigned int i;
+	int result = -EINVAL;
+
+	if (auth_cache_get_key(key) != 0) {
+		return -ENOENT;
+	}
+
+	memset(pad, HMAC_IPAD, sizeof(pad));
+	for (i = 0U; i < sizeof(key); i++) {
+		pad[i] ^= key_bytes[i];
+	}
+
+	if ((HASH_SHA256_Init(&hhash) != STD_OK) ||
+	    (HASH_SHA256_Accumulate(&hhash, pad, sizeof(pad)) != STD_OK) ||
+	    (HASH_SHA256_Accumulate(&hhash, (const uint8_t *)entry,
+				    offsetof(struct auth_cache_entry, tag)) !=
+	     STD_OK) ||
+	    (HASH_SHA256_Start(&hhash, signature,
+			       BOOT_API_ECDSA_SIGNATURE_LEN_IN_BYTES, inner,
+			       HASH_TIMEOUT_VALUE) != STD_OK)) {
+		goto out;
+	}
+
+	memset(pad, HMAC_OPAD, sizeof(pad));
+	for (i = 0U; i < sizeof(key); i++) {
+		pad[i] ^= key_bytes[i];
+	}
+
+	if ((HASH_SHA256_Init(&hhash) != STD_OK) ||
+	    (HASH_SHA256_Accumulate(&hhash, pad, sizeof(pad)) != STD_OK) ||
+	    (HASH_SHA256_Start(&hhash, inner, sizeof(inner), tag,
+			       HASH_TIMEOUT_VALUE) != STD_OK)) {
+		goto out;
+	}
+
+	result = 0;
+
+out:
+	zeromem(key, sizeof(key));
+	zeromem(pad, sizeof(pad));
+	zeromem(inner, sizeof(inner));
+
+	return result;
+}
+
+static bool auth_cache_same_image(const struct auth_cache_entry *a,
+				  const struct auth_cache_entry *b)
+{
+	return (a->valid == AUTH_CACHE_VALID) &&
+	       (a->image_id == b->image_id) &&
+	       (a->location == b->location) &&
+	       (a->offset == b->offset);
+}
+
+/* Fill an entry for the image being checked, but its tag */
+static int auth_cache_fill(struct auth_cache_entry *entry, uint32_t image_id,
+			   uintptr_t offset, const uint8_t *image_hash)
+{
+	boot_api_context_t *boot_context =
+		(boot_api_context_t *)stm32mp_get_boot_ctx_address();
+
+	if (stm32_get_otp_value(MONOTONIC_OTP, &entry->nv_counter) != 0) {
+		return -EINVAL;
+	}
+
+	entry->valid = AUTH_CACHE_VALID;
+	entry->image_id = image_id;
+	entry->location = ((uint32_t)boot_context->boot_interface_selected <<
+			   16) | boot_context->boot_interface_instance;
+	entry->offset = (uint32_t)offset;
+	memcpy(entry->digest, image_hash, sizeof(entry->digest));
+
+	return 0;
+}
+
+static bool auth_cache_lookup(const struct auth_cache_entry *entry,
+			      const uint8_t *signature)
+{
+	uint8_t tag[BOOT_API_SHA256_DIGEST_SIZE_IN_BYTES] __aligned(4);
+	const struct auth_cache_entry *cached = NULL;
+	uint8_t diff = 0U;
+	unsigned int i;
+
+	if (!auth_cache_loaded) {
+		stm32_get_auth_cache_from_context(auth_cache,
+						  sizeof(auth_cache));
+		auth_cache_loaded = true;
+	}
+
+	for (i = 0U; i < AUTH_CACHE_ENTRIES; i++) {
+		if (auth_cache_same_image(&auth_cache[i], entry)) {
+			cached = &auth_cache[i];
+			break;
+		}
+	}
+
+	if ((cached == NULL) ||
+	    (cached->nv_counter != entry->nv_counter) ||
+	    (memcmp(cached->digest, entry->digest,
+		    sizeof(entry->digest)) != 0)) {
+		return false;
+	}
+
+	if (auth_cache_mac(entry, signature, tag) != 0) {
+		return false;
+	}
+
+	/* Constant time comparison */
+	for (i = 0U; i < sizeof(tag); i++) {
+		diff |= tag[i] ^ cached->tag[i];
+	}
+
+	return diff == 0U;
+}
+
+static void auth_cache_update(struct auth_cache_entry *entry,
+			      const uint8_t *signature)
+{
+	unsigned int slot;
+
+	if (auth_cache_mac(entry, signature, entry->tag) != 0) {
+		return;
+	}
+
+	/*
+	 * Entries are kept newest first: the previous entry of this image, or
+	 * else the oldest one, is dropped.
+	 */
+	for (slot = 0U; slot < (AUTH_CACHE_ENTRIES - 1U); slot++) {
+		if (auth_cache_same_image(&auth_cache[slot], entry)) {
+			break;
+		}
+	}
+
+	memmove(&auth_cache[1], &auth_cache[0], slot * sizeof(*entry));
+	auth_cache[0] = *entry;
+	stm32_save_auth_cache_to_context(auth_cache, sizeof(auth_cache));
+}
+
+/* Verify the image signature, unless it matches the cache */
+static int auth_cache_verify(boot_api_image_header_t *header,
+			     uint8_t *image_hash, uint32_t image_id,
+			     uintptr_t offset)
+{
+	struct auth_cache_entry entry;
+	int result;
+
+	if (auth_cache_disabled ||
+	    (auth_cache_fill(&entry, image_id, offset, image_hash) != 0)) {
+		return auth_verify(header, image_hash);
+	}
+
+	if (auth_cache_lookup(&entry, header->image_signature)) {
+		INFO("Image already verified, signature check skipped\n");
+		return 0;
+	}
+
+	result = auth_verify(header, image_hash);
+	if (result == 0) {
+		auth_cache_update(&entry, header->image_signature);
+	}
+
+	return result;
+}
+#endif /* STM32MP_AUTH_CACHE */
+
+int check_header(boot_api_image_header_t *header, uintptr_t buffer)
+{
+	int result;
+
+	/*
+	 * Check header/payload validity:
+	 *	- Header magic
+	 *	- Header version
+	 *	- Payload checksum
+	 */
+	result = check_header_fields(header);
+	if (result != 0) {
+		return result;
+	}
+
+	return check_payload_checksum(header,
+				      payload_checksum(buffer,
+						       header->image_length));
+}
+
+int check_authentication(boot_api_image_header_t *header, uintptr_t buffer)
+{
+	HASH_HandleTypeDef hhash;
+	uint8_t image_hash[BOOT_API_SHA256_DIGEST_SIZE_IN_BYTES];
+	uint32_t uret;
+	int result;
+
+	result = auth_start(header, &hhash);
+	if (result != 0) {
+		return (result > 0) ? 0 : result;
+	}
+
+	uret = HASH_SHA256_Start(&hhash, (uint8_t *)buffer,
+				 header->image_length, image_hash,
+				 HASH_TIMEOUT_VALUE);
+	if (uret != STD_OK) {
+		ERROR("Hash of payload failed\n");
+		return -EINVAL;
+	}
+
+	result = auth_hash_finish(&hhash, image_hash);
+	if (result != 0) {
+		return result;
+	}
+
+	return auth_verify(header, image_hash);
+}
+
+/*
+ * Streamed variant of check_header() and check_authentication(): the payload
+ * is checksummed and hashed chunk by chunk, as it is loaded from storage,
+ * while each chunk is still hot in the data cache. There is a single HASH
+ * instance, so only one image can be streamed at a time.
+ */
+static struct {
+	boot_api_image_header_t *header;
+	HASH_HandleTypeDef hhash;
+	uint32_t checksum;
+	uint32_t length;	/* Payload bytes already processed */
+	uint32_t image_id;	/* Binary type, for the verified image cache */
+	uintptr_t offset;	/* Image offset in the boot device */
+	bool authenticate;	/* Payload is hashed for signature check */
+	int auth_result;	/* Authentication error, reported at the end */
+	uint8_t image_hash[BOOT_API_SHA256_DIGEST_SIZE_IN_BYTES];
+} stream;
+
+int stm32mp_check_image_start(boot_api_image_header_t *header,
+			      bool authenticate, uint32_t image_id,
+			      uintptr_t offset)
+{
+	int result;
+
+	result = check_header_fields(header);
+	if (result != 0) {
+		return result;
+	}
+
+	stream.header = header;
+	stream.checksum = 0U;
+	stream.length = 0U;
+	stream.image_id = image_id;
+	stream.offset = offset;
+	stream.authenticate = false;
+	stream.auth_result = 0;
+
+	if (!authenticate) {
+		return 0;
+	}
+
+	/*
+	 * Key and hash errors are authentication failures, not header ones:
+	 * they are returned by stm32mp_check_image_signature(), so that the
+	 * caller doesn't fall back to a backup copy for them.
+	 */
+	result = auth_start(header, &stream.hhash);
+	if (result < 0) {
+		stream.auth_result = result;
+		return 0;
+	}
+
+	stream.authenticate = (result == 0);
+
+	return 0;
+}
+
+/*
+ * Feed the next payload chunk. Data beyond the image length are ignored.
+ * All chunks but the last one must be a multiple of 4 bytes long.
+ */
+int stm32mp_check_image_update(uintptr_t buffer, size_t length)
+{
+	uint32_t left = stream.header->image_length - stream.length;
+	uint32_t uret;
+
+	if (length > left) {
+		length = left;
+	}
+
+	if (length == 0U) {
+		return 0;
+	}
+
+	stream.checksum += payload_checksum(buffer, length);
+	stream.length += length;
+
+	if (!stream.authenticate) {
+		return 0;
+	}
+
+	if (stream.length == stream.header->image_length) {
+		uret = HASH_SHA256_Start(&stream.hhash, (uint8_t *)buffer,
+					 length, stream.image_hash,
+					 HASH_TIMEOUT_VALUE);
+	} else {
+		assert((length % sizeof(uint32_t)) == 0U);
+		uret = HASH_SHA256_Accumulate(&stream.hhash,
+					      (uint8_t *)buffer, length);
+	}
+
+	if (uret != STD_OK) {
+		ERROR("Hash of payload failed\n");
+		stream.auth_result = -EINVAL;
+		stream.authenticate = false;
+	}
+
+	return 0;
+}
+
+int stm32mp_check_image_checksum(void)
+{
+	if (stream.length != stream.header->image_length) {
+		ERROR("Image truncated\n");
+		return -EINVAL;
+	}
+
+	return check_payload_checksum(stream.header, stream.checksum);
+}
+
+int stm32mp_check_image_signature(void)
+{
+	int result;
+
+	if (stream.auth_result != 0) {
+		return stream.auth_result;
+	}
+
+	if (!stream.authenticate) {
+		return 0;
+	}
+
+	if (stream.length != stream.header->image_length) {
+		ERROR("Image truncated\n");
+		return -EINVAL;
+	}
+
+	result = auth_hash_finish(&stream.hhash, stream.image_hash);
+	if (result != 0) {
+		return result;
+	}
+
+#if STM32MP_AUTH_CACHE
+	return auth_cache_verify(stream.header, stream.image_hash,
+				 stream.image_id, stream.offset);
+#else
+	return auth_verify(stream.header, stream.image_hash);
+#endif
+}
@@ -8,6 +8,7 @@
 #define STM32MP1_CONTEXT_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #define DDR_CRC_GRANULE		32
@@ -25,5 +26,7 @@ int stm32_get_boot_interface(uint32_t *interface, uint32_t *instance);
 void stm32_save_ddr_training_area(void);
 void stm32_restore_ddr_training_area(void);
 uint32_t stm32_pm_get_optee_ep(void);
+void stm32_get_auth_cache_from_context(void *cache, size_t size);
+void stm32_save_auth_cache_to_context(const void *cache, size_t size);
 
 #endif /* STM32MP1_CONTEXT_H */
@@ -9,6 +9,7 @@ ARM_WITH_NEON		:=	yes
 BL2_AT_EL3		:=	1
 USE_COHERENT_MEM	:=	0
 MULTI_CONSOLE_API	:=	1
+LIBC_OPTIMIZED_MEMOPS	:=	1
 
 # Add specific ST version
 ST_VERSION 		:=	r3.0
@@ -51,6 +52,19 @@ PLAT_PARTITION_MAX_ENTRIES	:=	$(shell echo $$(($(STM32_TF_A_COPIES) + 1)))
 endif
 $(eval $(call add_define,PLAT_PARTITION_MAX_ENTRIES))
 
+# GPT entries are read and checked through a 4 blocks buffer
+PLAT_PARTITION_ENTRY_BUF_SIZE	:=	2048
+$(eval $(call add_define,PLAT_PARTITION_ENTRY_BUF_SIZE))
+
+# Number of io_block cache lines, used when reading the GPT
+PLAT_IO_BLOCK_CACHE_LINES	?=	2
+$(eval $(call add_define,PLAT_IO_BLOCK_CACHE_LINES))
+
+# Skip the signature check of images already verified on a previous boot
+STM32MP_AUTH_CACHE		?=	0
+$(eval $(call assert_boolean,STM32MP_AUTH_CACHE))
+$(eval $(call add_define,STM32MP_AUTH_CACHE))
+
 STM32MP_BOOT_ONLY		?=	0
 STM32MP_FLASHLOADER_ONLY	?=	0
 
@@ -170,7 +184,8 @@ BL2_SOURCES		+=	drivers/st/nand/io_nand.c				\
 endif
 
 ifneq ($(filter 1,${STM32MP_EMMC} ${STM32MP_SDMMC}),)
-BL2_SOURCES		+=	drivers/mmc/mmc.c					\
+BL2_SOURCES		+=	common/tf_crc32.c					\
+				drivers/mmc/mmc.c					\
 				drivers/partition/gpt.c					\
 				drivers/partition/partition.c				\
 				drivers/st/io/io_mmc.c					\
@@ -5,7 +5,9 @@
  */
 
 #include <arch_helpers.h>
+#include <assert.h>
 #include <boot_api.h>
+#include <cassert.h>
 #include <context.h>
 #include <context_mgmt.h>
 #include <dt-bindings/clock/stm32mp1-clks.h>
@@ -27,6 +29,12 @@
 
 #define TRAINING_AREA_SIZE		64
 
+/* Verified image cache, kept at the end of Backup SRAM */
+#define AUTH_CACHE_AREA_SIZE		U(0x200)
+#define AUTH_CACHE_AREA_BASE		(STM32MP_BACKUP_RAM_BASE + \
+					 STM32MP_BACKUP_RAM_SIZE - \
+					 AUTH_CACHE_AREA_SIZE)
+
 #ifdef AARCH32_SP_OPTEE
 /*
  * OPTEE_MAILBOX_MAGIC relates to struct backup_data_s as defined
@@ -71,6 +79,12 @@ struct backup_data_s {
 #endif
 };
 
+#if STM32MP_AUTH_CACHE
+CASSERT(sizeof(struct backup_data_s) <=
+	(STM32MP_BACKUP_RAM_SIZE - AUTH_CACHE_AREA_SIZE),
+	assert_backup_data_overlaps_auth_cache);
+#endif
+
 #ifdef AARCH32_SP_OPTEE
 uint32_t stm32_pm_get_optee_ep(void)
 {
@@ -315,3 +329,33 @@ void stm32_restore_ddr_training_area(void)
 
 	stm32mp_clk_disable(BKPSRAM);
 }
+
+#if STM32MP_AUTH_CACHE
+/*
+ * The verified image cache is opaque here: its entries are authenticated by
+ * stm32mp_auth. It is not cleared with the rest of the context, so that it
+ * survives warm boots and standby exits.
+ */
+void stm32_get_auth_cache_from_context(void *cache, size_t size)
+{
+	assert(size <= AUTH_CACHE_AREA_SIZE);
+
+	stm32mp_clk_enable(BKPSRAM);
+
+	memcpy(cache, (const void *)AUTH_CACHE_AREA_BASE, size);
+
+	stm32mp_clk_disable(BKPSRAM);
+}
+
+void stm32_save_auth_cache_to_context(const void *cache, size_t size)
+{
+	assert(size <= AUTH_CACHE_AREA_SIZE);
+
+	stm32mp_clk_enable(BKPSRAM);
+
+	memcpy((void *)AUTH_CACHE_AREA_BASE, cache, size);
+	dsb();
+
+	stm32mp_clk_disable(BKPSRAM);
+}
+#endif
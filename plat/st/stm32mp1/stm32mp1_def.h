@@ -391,6 +391,7 @@ enum ddr_type {
 #define MONOTONIC_OTP			"monotonic_otp"
 #define UID_OTP				"uid_otp"
 #define BOARD_ID_OTP			"board_id"
+#define AUTH_CACHE_KEY_OTP		"auth_cache_key"
 
 /* OTP mask */
 /* PART NUMBER */
@@ -0,0 +1,21 @@
+/*
+ * Copyright (c) 2020, ARM Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef JOBS_H_
+#define JOBS_H_
+
+/*
+ * Job callbacks. 'run' returns 0 on success. 'dep' returns the index of the
+ * job that must have completed before the given one can start, or -1.
+ */
+typedef int (*job_run_fn_t)(unsigned int idx);
+typedef int (*job_dep_fn_t)(unsigned int idx);
+
+/* Exported API */
+int jobs_run(unsigned int num_threads, unsigned int num_jobs,
+	     job_run_fn_t run, job_dep_fn_t dep);
+
+#endif /* JOBS_H_ */
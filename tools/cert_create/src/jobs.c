@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2020, ARM Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "debug.h"
+#include "jobs.h"
+
+/* Job states */
+enum {
+	JOB_PENDING,
+	JOB_RUNNING,
+	JOB_DONE,
+	JOB_FAILED
+};
+
+/* Set of jobs being run, shared by the worker threads */
+struct jobs_s {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	unsigned int num_jobs;
+	unsigned int num_left;
+	unsigned char *state;
+	job_run_fn_t run;
+	job_dep_fn_t dep;
+};
+
+/*
+ * Return the index of the first pending job that can be started, or -1. Jobs
+ * depending on a failed job fail as well. Called with the lock held.
+ */
+static int jobs_get_next(struct jobs_s *jobs)
+{
+	unsigned int i;
+	int dep;
+
+	for (i = 0; i < jobs->num_jobs; i++) {
+		if (jobs->state[i] != JOB_PENDING) {
+			continue;
+		}
+
+		dep = (jobs->dep != NULL) ? jobs->dep(i) : -1;
+		if ((dep < 0) || (jobs->state[dep] == JOB_DONE)) {
+			return i;
+		}
+
+		if (jobs->state[dep] == JOB_FAILED) {
+			jobs->state[i] = JOB_FAILED;
+			jobs->num_left--;
+			pthread_cond_broadcast(&jobs->cond);
+		}
+	}
+
+	return -1;
+}
+
+static void *jobs_worker(void *arg)
+{
+	struct jobs_s *jobs = arg;
+	int idx, rc;
+
+	pthread_mutex_lock(&jobs->lock);
+
+	while (jobs->num_left != 0) {
+		idx = jobs_get_next(jobs);
+		if (idx < 0) {
+			/* Wait for a running job to complete */
+			if (jobs->num_left != 0) {
+				pthread_cond_wait(&jobs->cond, &jobs->lock);
+			}
+			continue;
+		}
+
+		jobs->state[idx] = JOB_RUNNING;
+		pthread_mutex_unlock(&jobs->lock);
+
+		rc = jobs->run(idx);
+
+		pthread_mutex_lock(&jobs->lock);
+		jobs->state[idx] = (rc == 0) ? JOB_DONE : JOB_FAILED;
+		jobs->num_left--;
+		pthread_cond_broadcast(&jobs->cond);
+	}
+
+	pthread_mutex_unlock(&jobs->lock);
+
+	return NULL;
+}
+
+/*
+ * Run a set of jobs on up to 'num_threads' threads, starting them in index
+ * order as soon as their dependency has completed. With a single thread, jobs
+ * are run in order from the calling thread.
+ *
+ * Return 0 if all jobs succeeded.
+ */
+int jobs_run(unsigned int num_threads, unsigned int num_jobs,
+	     job_run_fn_t run, job_dep_fn_t dep)
+{
+	struct jobs_s jobs;
+	pthread_t *threads;
+	unsigned int i, num_started = 0;
+	int rc = 0;
+
+	if (num_jobs == 0) {
+		return 0;
+	}
+
+	jobs.num_jobs = num_jobs;
+	jobs.num_left = num_jobs;
+	jobs.run = run;
+	jobs.dep = dep;
+	jobs.state = calloc(num_jobs, sizeof(*jobs.state));
+	if (jobs.state == NULL) {
+		ERROR("Cannot allocate jobs\n");
+		return 1;
+	}
+
+	pthread_mutex_init(&jobs.lock, NULL);
+	pthread_cond_init(&jobs.cond, NULL);
+
+	if (num_threads > num_jobs) {
+		num_threads = num_jobs;
+	}
+
+	threads = calloc(num_threads, sizeof(*threads));
+	if (threads == NULL) {
+		ERROR("Cannot allocate threads\n");
+		rc = 1;
+		goto end;
+	}
+
+	/* The calling thread is one of the workers */
+	for (i = 1; i < num_threads; i++) {
+		if (pthread_create(&threads[i], NULL, jobs_worker,
+				   &jobs) != 0) {
+			WARN("Cannot create thread, using %u\n", i);
+			break;
+		}
+		num_started++;
+	}
+
+	jobs_worker(&jobs);
+
+	for (i = 1; i <= num_started; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	for (i = 0; i < num_jobs; i++) {
+		if (jobs.state[i] != JOB_DONE) {
+			rc = 1;
+		}
+	}
+
+	free(threads);
+end:
+	pthread_cond_destroy(&jobs.cond);
+	pthread_mutex_destroy(&jobs.lock);
+	free(jobs.state);
+
+	return rc;
+}
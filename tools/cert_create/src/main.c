@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2015-2017, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2015-2020, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -28,6 +28,7 @@
 #include "cmd_opt.h"
 #include "debug.h"
 #include "ext.h"
+#include "jobs.h"
 #include "key.h"
 #include "sha.h"
 #include "tbbr/tbb_cert.h"
@@ -65,6 +66,8 @@
 #define ID_TO_BIT_MASK(id)		(1 << id)
 #define NUM_ELEM(x)			((sizeof(x)) / (sizeof(x[0])))
 #define HELP_OPT_MAX_LEN		128
+#define BATCH_LINE_MAX_LEN		4096
+#define BATCH_MAX_ARGS			256
 
 /* Global options */
 static int key_alg;
@@ -72,6 +75,15 @@ static int hash_alg;
 static int new_keys;
 static int save_keys;
 static int print_cert;
+static unsigned int num_jobs = 1;
+static const char *batch_fn;
+
+/* Image hash algorithm indicated in the certificate extensions */
+static const EVP_MD *md_info;
+static unsigned int md_len;
+
+/* Keys to be created, in the same order as keys[] */
+static int *new_key_ids;
 
 /* Info messages created in the Makefile */
 extern const char build_msg[];
@@ -234,6 +246,298 @@ static void check_cmd_params(void)
 	}
 }
 
+/*
+ * Create a certificate with its extensions, signed with its issuer key. The
+ * issuer certificate, if any, must have been created before.
+ */
+static int create_cert(unsigned int i)
+{
+	STACK_OF(X509_EXTENSION) * sk;
+	X509_EXTENSION *cert_ext = NULL;
+	unsigned char md[SHA512_DIGEST_LENGTH];
+	cert_t *cert = &certs[i];
+	ext_t *ext;
+	int j, ext_nid, nvctr;
+
+	/* Create a new stack of extensions. This stack will be used
+	 * to create the certificate */
+	CHECK_NULL(sk, sk_X509_EXTENSION_new_null());
+
+	for (j = 0 ; j < cert->num_ext ; j++) {
+
+		ext = &extensions[cert->ext[j]];
+
+		/* Get OpenSSL internal ID for this extension */
+		CHECK_OID(ext_nid, ext->oid);
+
+		/*
+		 * Three types of extensions are currently supported:
+		 *     - EXT_TYPE_NVCOUNTER
+		 *     - EXT_TYPE_HASH
+		 *     - EXT_TYPE_PKEY
+		 */
+		switch (ext->type) {
+		case EXT_TYPE_NVCOUNTER:
+			if (ext->arg) {
+				nvctr = atoi(ext->arg);
+				CHECK_NULL(cert_ext, ext_new_nvcounter(ext_nid,
+					EXT_CRIT, nvctr));
+			}
+			break;
+		case EXT_TYPE_HASH:
+			if (ext->arg == NULL) {
+				if (ext->optional) {
+					/* Include a hash filled with zeros */
+					memset(md, 0x0, SHA512_DIGEST_LENGTH);
+				} else {
+					/* Do not include this hash in the certificate */
+					break;
+				}
+			} else {
+				/* Calculate the hash of the file */
+				if (!sha_file(hash_alg, ext->arg, md)) {
+					ERROR("Cannot calculate hash of %s\n",
+						ext->arg);
+					exit(1);
+				}
+			}
+			CHECK_NULL(cert_ext, ext_new_hash(ext_nid,
+					EXT_CRIT, md_info, md,
+					md_len));
+			break;
+		case EXT_TYPE_PKEY:
+			CHECK_NULL(cert_ext, ext_new_key(ext_nid,
+				EXT_CRIT, keys[ext->attr.key].key));
+			break;
+		default:
+			ERROR("Unknown extension type '%d' in %s\n",
+					ext->type, cert->cn);
+			exit(1);
+		}
+
+		/* Push the extension into the stack */
+		sk_X509_EXTENSION_push(sk, cert_ext);
+	}
+
+	/* Create certificate. Signed with corresponding key */
+	if (cert->fn && !cert_new(key_alg, hash_alg, cert, VAL_DAYS, 0, sk)) {
+		ERROR("Cannot create %s\n", cert->cn);
+		exit(1);
+	}
+
+	sk_X509_EXTENSION_free(sk);
+
+	return 0;
+}
+
+/* A certificate must wait for its issuer certificate, if it is created */
+static int cert_issuer_dep(unsigned int i)
+{
+	int issuer = certs[i].issuer;
+
+	if ((issuer == (int)i) || (certs[issuer].fn == NULL)) {
+		return -1;
+	}
+
+	return issuer;
+}
+
+/* Create the i-th key that was neither provided nor found on disk */
+static int create_key(unsigned int i)
+{
+	key_t *key = &keys[new_key_ids[i]];
+
+	if (!key_create(key, key_alg)) {
+		ERROR("Error creating key '%s'\n", key->desc);
+		return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * Create the requested certificates with the current extension arguments,
+ * then print them and save them to their files.
+ */
+static void create_cert_set(void)
+{
+	FILE *file;
+	int i;
+
+	/* Create the certificates, once their issuer certificate exists */
+	if (jobs_run(num_jobs, num_certs, create_cert, cert_issuer_dep) != 0) {
+		exit(1);
+	}
+
+	/* Print the certificates */
+	if (print_cert) {
+		for (i = 0 ; i < num_certs ; i++) {
+			if (!certs[i].x) {
+				continue;
+			}
+			printf("\n\n=====================================\n\n");
+			X509_print_fp(stdout, certs[i].x);
+		}
+	}
+
+	/* Save created certificates to files */
+	for (i = 0 ; i < num_certs ; i++) {
+		if (certs[i].x && certs[i].fn) {
+			file = fopen(certs[i].fn, "w");
+			if (file != NULL) {
+				i2d_X509_fp(file, certs[i].x);
+				fclose(file);
+			} else {
+				ERROR("Cannot create file %s\n", certs[i].fn);
+			}
+		}
+	}
+}
+
+/*
+ * Restore the extension arguments and certificate files given in the command
+ * line, and drop the certificates of the previous set.
+ */
+static void batch_reset(const char **ext_args, const char **cert_fns)
+{
+	int i;
+
+	for (i = 0 ; i < num_extensions ; i++) {
+		if (extensions[i].arg != ext_args[i]) {
+			free((void *)extensions[i].arg);
+			extensions[i].arg = ext_args[i];
+		}
+	}
+
+	for (i = 0 ; i < num_certs ; i++) {
+		if (certs[i].fn != cert_fns[i]) {
+			free((void *)certs[i].fn);
+			certs[i].fn = cert_fns[i];
+		}
+		X509_free(certs[i].x);
+		certs[i].x = NULL;
+	}
+}
+
+/*
+ * Create one set of certificates per line of the manifest file. Each line
+ * holds image, non-volatile counter and certificate options, in the same
+ * format as the command line, which override the ones given in the command
+ * line for this set only. Empty lines and lines starting with '#' are
+ * skipped. Keys are loaded once for all sets, and each image is only hashed
+ * once (see sha_file()).
+ */
+static void batch_run(const char *fn, const struct option *cmd_opt)
+{
+	const char **ext_args, **cert_fns;
+	char line[BATCH_LINE_MAX_LEN];
+	char *args[BATCH_MAX_ARGS];
+	const char *cur_opt;
+	FILE *file;
+	cert_t *cert;
+	ext_t *ext;
+	char *p;
+	unsigned int line_num = 0, num_sets = 0;
+	int i, c, num_args, opt_idx = 0;
+
+	file = fopen(fn, "r");
+	if (file == NULL) {
+		ERROR("Cannot open %s\n", fn);
+		exit(1);
+	}
+
+	/* Arguments shared by all the sets */
+	CHECK_NULL(ext_args, calloc(num_extensions, sizeof(*ext_args)));
+	CHECK_NULL(cert_fns, calloc(num_certs, sizeof(*cert_fns)));
+	for (i = 0 ; i < num_extensions ; i++) {
+		ext_args[i] = extensions[i].arg;
+	}
+	for (i = 0 ; i < num_certs ; i++) {
+		cert_fns[i] = certs[i].fn;
+	}
+
+	while (fgets(line, sizeof(line), file) != NULL) {
+		line_num++;
+
+		if ((strchr(line, '\n') == NULL) && !feof(file)) {
+			ERROR("%s:%u: line too long\n", fn, line_num);
+			exit(1);
+		}
+
+		/* Split the line into arguments, after a dummy program name */
+		num_args = 0;
+		args[num_args++] = (char *)fn;
+		for (p = strtok(line, " \t\r\n"); p != NULL;
+		     p = strtok(NULL, " \t\r\n")) {
+			if (num_args == BATCH_MAX_ARGS - 1) {
+				ERROR("%s:%u: too many arguments\n", fn,
+				      line_num);
+				exit(1);
+			}
+			args[num_args++] = p;
+		}
+		args[num_args] = NULL;
+
+		if ((num_args == 1) || (args[1][0] == '#')) {
+			continue;
+		}
+
+		batch_reset(ext_args, cert_fns);
+
+		/* Restart the option scanning from the first argument */
+		optind = 0;
+		while ((c = getopt_long(num_args, args, "", cmd_opt,
+					&opt_idx)) != -1) {
+			cur_opt = cmd_opt_get_name(opt_idx);
+			switch (c) {
+			case CMD_OPT_EXT:
+				ext = ext_get_by_opt(cur_opt);
+				if (ext->arg != ext_args[ext - extensions]) {
+					free((void *)ext->arg);
+				}
+				ext->arg = strdup(optarg);
+				break;
+			case CMD_OPT_CERT:
+				cert = cert_get_by_opt(cur_opt);
+				if (cert->fn != cert_fns[cert - certs]) {
+					free((void *)cert->fn);
+				}
+				cert->fn = strdup(optarg);
+				break;
+			default:
+				ERROR("%s:%u: only image, counter and "
+				      "certificate options are allowed\n",
+				      fn, line_num);
+				exit(1);
+			}
+		}
+
+		if (optind != num_args) {
+			ERROR("%s:%u: unexpected argument '%s'\n", fn,
+			      line_num, args[optind]);
+			exit(1);
+		}
+
+		NOTICE("Creating certificate set %u (%s:%u)\n", num_sets,
+		       fn, line_num);
+		check_cmd_params();
+		create_cert_set();
+		num_sets++;
+	}
+
+	if (ferror(file)) {
+		ERROR("Cannot read %s\n", fn);
+		exit(1);
+	}
+
+	fclose(file);
+	batch_reset(ext_args, cert_fns);
+	free(ext_args);
+	free(cert_fns);
+
+	NOTICE("%u certificate sets created\n", num_sets);
+}
+
 /* Common command line options */
 static const cmd_opt_t common_cmd_opt[] = {
 	{
@@ -260,25 +564,29 @@ PKCS#1 v2.1, 'rsa_1_5' - RSA PKCS#1 v1.5, 'ecdsa'"
 	{
 		{ "print-cert", no_argument, NULL, 'p' },
 		"Print the certificates in the standard output"
+	},
+	{
+		{ "jobs", required_argument, NULL, 'j' },
+		"Number of threads used to create keys and certificates \
+(default 1)"
+	},
+	{
+		{ "batch", required_argument, NULL, 'b' },
+		"Manifest file listing one set of certificates per line, as \
+image, non-volatile counter and certificate options"
 	}
 };
 
 int main(int argc, char *argv[])
 {
-	STACK_OF(X509_EXTENSION) * sk;
-	X509_EXTENSION *cert_ext = NULL;
 	ext_t *ext;
 	key_t *key;
 	cert_t *cert;
-	FILE *file;
-	int i, j, ext_nid, nvctr;
+	int i;
 	int c, opt_idx = 0;
 	const struct option *cmd_opt;
 	const char *cur_opt;
-	unsigned int err_code;
-	unsigned char md[SHA512_DIGEST_LENGTH];
-	unsigned int  md_len;
-	const EVP_MD *md_info;
+	unsigned int err_code, num_new_keys = 0;
 
 	NOTICE("CoT Generation Tool: %s\n", build_msg);
 	NOTICE("Target platform: %s\n", platform_msg);
@@ -315,7 +623,7 @@ int main(int argc, char *argv[])
 
 	while (1) {
 		/* getopt_long stores the option index here. */
-		c = getopt_long(argc, argv, "a:hknps:", cmd_opt, &opt_idx);
+		c = getopt_long(argc, argv, "a:b:hj:knps:", cmd_opt, &opt_idx);
 
 		/* Detect the end of the options. */
 		if (c == -1) {
@@ -330,9 +638,19 @@ int main(int argc, char *argv[])
 				exit(1);
 			}
 			break;
+		case 'b':
+			batch_fn = optarg;
+			break;
 		case 'h':
 			print_help(argv[0], cmd_opt);
 			exit(0);
+		case 'j':
+			num_jobs = atoi(optarg);
+			if (num_jobs < 1) {
+				ERROR("Invalid number of jobs '%s'\n", optarg);
+				exit(1);
+			}
+			break;
 		case 'k':
 			save_keys = 1;
 			break;
@@ -371,8 +689,11 @@ int main(int argc, char *argv[])
 		}
 	}
 
-	/* Check command line arguments */
-	check_cmd_params();
+	/* Check command line arguments. In batch mode, they are completed by
+	 * each line of the manifest, which is checked before being used */
+	if (batch_fn == NULL) {
+		check_cmd_params();
+	}
 
 	/* Indicate SHA as image hash algorithm in the certificate
 	 * extension */
@@ -388,6 +709,7 @@ int main(int argc, char *argv[])
 	}
 
 	/* Load private keys from files (or generate new ones) */
+	CHECK_NULL(new_key_ids, calloc(num_keys, sizeof(*new_key_ids)));
 	for (i = 0 ; i < num_keys ; i++) {
 		if (!key_new(&keys[i])) {
 			ERROR("Failed to allocate key container\n");
@@ -413,10 +735,7 @@ int main(int argc, char *argv[])
 		if (new_keys) {
 			/* Try to create a new key */
 			NOTICE("Creating new key for '%s'\n", keys[i].desc);
-			if (!key_create(&keys[i], key_alg)) {
-				ERROR("Error creating key '%s'\n", keys[i].desc);
-				exit(1);
-			}
+			new_key_ids[num_new_keys++] = i;
 		} else {
 			if (err_code == KEY_ERR_OPEN) {
 				ERROR("Error opening '%s'\n", keys[i].fn);
@@ -427,103 +746,16 @@ int main(int argc, char *argv[])
 		}
 	}
 
-	/* Create the certificates */
-	for (i = 0 ; i < num_certs ; i++) {
-
-		cert = &certs[i];
-
-		/* Create a new stack of extensions. This stack will be used
-		 * to create the certificate */
-		CHECK_NULL(sk, sk_X509_EXTENSION_new_null());
-
-		for (j = 0 ; j < cert->num_ext ; j++) {
-
-			ext = &extensions[cert->ext[j]];
-
-			/* Get OpenSSL internal ID for this extension */
-			CHECK_OID(ext_nid, ext->oid);
-
-			/*
-			 * Three types of extensions are currently supported:
-			 *     - EXT_TYPE_NVCOUNTER
-			 *     - EXT_TYPE_HASH
-			 *     - EXT_TYPE_PKEY
-			 */
-			switch (ext->type) {
-			case EXT_TYPE_NVCOUNTER:
-				if (ext->arg) {
-					nvctr = atoi(ext->arg);
-					CHECK_NULL(cert_ext, ext_new_nvcounter(ext_nid,
-						EXT_CRIT, nvctr));
-				}
-				break;
-			case EXT_TYPE_HASH:
-				if (ext->arg == NULL) {
-					if (ext->optional) {
-						/* Include a hash filled with zeros */
-						memset(md, 0x0, SHA512_DIGEST_LENGTH);
-					} else {
-						/* Do not include this hash in the certificate */
-						break;
-					}
-				} else {
-					/* Calculate the hash of the file */
-					if (!sha_file(hash_alg, ext->arg, md)) {
-						ERROR("Cannot calculate hash of %s\n",
-							ext->arg);
-						exit(1);
-					}
-				}
-				CHECK_NULL(cert_ext, ext_new_hash(ext_nid,
-						EXT_CRIT, md_info, md,
-						md_len));
-				break;
-			case EXT_TYPE_PKEY:
-				CHECK_NULL(cert_ext, ext_new_key(ext_nid,
-					EXT_CRIT, keys[ext->attr.key].key));
-				break;
-			default:
-				ERROR("Unknown extension type '%d' in %s\n",
-						ext->type, cert->cn);
-				exit(1);
-			}
-
-			/* Push the extension into the stack */
-			sk_X509_EXTENSION_push(sk, cert_ext);
-		}
-
-		/* Create certificate. Signed with corresponding key */
-		if (cert->fn && !cert_new(key_alg, hash_alg, cert, VAL_DAYS, 0, sk)) {
-			ERROR("Cannot create %s\n", cert->cn);
-			exit(1);
-		}
-
-		sk_X509_EXTENSION_free(sk);
-	}
-
-
-	/* Print the certificates */
-	if (print_cert) {
-		for (i = 0 ; i < num_certs ; i++) {
-			if (!certs[i].x) {
-				continue;
-			}
-			printf("\n\n=====================================\n\n");
-			X509_print_fp(stdout, certs[i].x);
-		}
+	/* Keys are independent, create them in parallel */
+	if (jobs_run(num_jobs, num_new_keys, create_key, NULL) != 0) {
+		exit(1);
 	}
+	free(new_key_ids);
 
-	/* Save created certificates to files */
-	for (i = 0 ; i < num_certs ; i++) {
-		if (certs[i].x && certs[i].fn) {
-			file = fopen(certs[i].fn, "w");
-			if (file != NULL) {
-				i2d_X509_fp(file, certs[i].x);
-				fclose(file);
-			} else {
-				ERROR("Cannot create file %s\n", certs[i].fn);
-			}
-		}
+	if (batch_fn != NULL) {
+		batch_run(batch_fn, cmd_opt);
+	} else {
+		create_cert_set();
 	}
 
 	/* Save keys */
@@ -1,17 +1,72 @@
 /*
- * Copyright (c) 2015-2017, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2015-2020, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
 
 #include <openssl/sha.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "debug.h"
 #include "key.h"
 
 #define BUFFER_SIZE	256
 
-int sha_file(int md_alg, const char *filename, unsigned char *md)
+/* Digest of an image already hashed in this process */
+typedef struct sha_cache_entry_s {
+	struct sha_cache_entry_s *next;
+	int md_alg;
+	unsigned char md[SHA512_DIGEST_LENGTH];
+	char filename[];
+} sha_cache_entry_t;
+
+static sha_cache_entry_t *sha_cache;
+static pthread_mutex_t sha_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int sha_cache_get(int md_alg, const char *filename, unsigned char *md)
+{
+	sha_cache_entry_t *entry;
+	int found = 0;
+
+	pthread_mutex_lock(&sha_cache_lock);
+	for (entry = sha_cache; entry != NULL; entry = entry->next) {
+		if ((entry->md_alg == md_alg) &&
+		    (strcmp(entry->filename, filename) == 0)) {
+			memcpy(md, entry->md, SHA512_DIGEST_LENGTH);
+			found = 1;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&sha_cache_lock);
+
+	return found;
+}
+
+static void sha_cache_add(int md_alg, const char *filename,
+			  const unsigned char *md)
+{
+	sha_cache_entry_t *entry;
+	size_t len = strlen(filename) + 1;
+
+	/* Not caching the digest only costs hashing the image again */
+	entry = malloc(sizeof(*entry) + len);
+	if (entry == NULL) {
+		return;
+	}
+
+	memcpy(entry->filename, filename, len);
+	entry->md_alg = md_alg;
+	memcpy(entry->md, md, SHA512_DIGEST_LENGTH);
+
+	pthread_mutex_lock(&sha_cache_lock);
+	entry->next = sha_cache;
+	sha_cache = entry;
+	pthread_mutex_unlock(&sha_cache_lock);
+}
+
+static int sha_file_read(int md_alg, const char *filename, unsigned char *md)
 {
 	FILE *inFile;
 	SHA256_CTX shaContext;
@@ -19,11 +74,6 @@ int sha_file(int md_alg, const char *filename, unsigned char *md)
 	int bytes;
 	unsigned char data[BUFFER_SIZE];
 
-	if ((filename == NULL) || (md == NULL)) {
-		ERROR("%s(): NULL argument\n", __FUNCTION__);
-		return 0;
-	}
-
 	inFile = fopen(filename, "rb");
 	if (inFile == NULL) {
 		ERROR("Cannot read %s\n", filename);
@@ -53,3 +103,29 @@ int sha_file(int md_alg, const char *filename, unsigned char *md)
 	fclose(inFile);
 	return 1;
 }
+
+/*
+ * Calculate the hash of a file. Digests are kept for the lifetime of the
+ * process, so an image referenced by several certificates (or certificate
+ * sets in batch mode) is only read and hashed once.
+ */
+int sha_file(int md_alg, const char *filename, unsigned char *md)
+{
+	if ((filename == NULL) || (md == NULL)) {
+		ERROR("%s(): NULL argument\n", __FUNCTION__);
+		return 0;
+	}
+
+	if (sha_cache_get(md_alg, filename, md)) {
+		return 1;
+	}
+
+	memset(md, 0, SHA512_DIGEST_LENGTH);
+	if (!sha_file_read(md_alg, filename, md)) {
+		return 0;
+	}
+
+	sha_cache_add(md_alg, filename, md);
+
+	return 1;
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2016-2017, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2016-2020, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -22,6 +22,18 @@
 #define OPT_TOC_ENTRY 0
 #define OPT_PLAT_TOC_FLAGS 1
 #define OPT_ALIGN 2
+#define OPT_IN_PLACE 3
+#define OPT_JSON 4
+#define OPT_TREE_HASH 5
+
+/* Size of the chunks hashed in parallel for the tree digest. */
+#define TREE_HASH_CHUNK_SIZE (1024 * 1024)
+
+/* copy_file_range() lets the kernel copy payloads between files. */
+#if defined(__linux__) && defined(__GLIBC__) && \
+    ((__GLIBC__ > 2) || (__GLIBC_MINOR__ >= 27))
+#define HAVE_COPY_FILE_RANGE 1
+#endif
 
 static int info_cmd(int argc, char *argv[]);
 static void info_usage(void);
@@ -50,7 +62,14 @@ static cmd_t cmds[] = {
 };
 
 static image_desc_t *image_desc_head;
+static image_desc_t **image_desc_tail = &image_desc_head;
 static size_t nr_image_descs;
+/* Descriptors of toc_entries[], allocated at once. */
+static image_desc_t *image_desc_table;
+static size_t nr_table_descs;
+static desc_index_t desc_by_uuid;
+static desc_index_t desc_by_opt;
+static file_map_t *file_map_head;
 static const uuid_t uuid_null;
 static int verbose;
 
@@ -134,6 +153,168 @@ static void xfwrite(void *buf, size_t size, FILE *fp, const char *filename)
 		log_errx("Failed to write %s", filename);
 }
 
+/*
+ * Map a whole file in memory, so that images can reference their payload in
+ * place. If the file cannot be mapped, it is read to memory instead. Files
+ * stay mapped until unmap_files() is called.
+ */
+static file_map_t *map_file(const char *filename)
+{
+	struct BLD_PLAT_STAT st;
+	file_map_t *map;
+	FILE *fp;
+
+	fp = fopen(filename, "rb");
+	if (fp == NULL)
+		log_err("fopen %s", filename);
+
+	if (fstat(fileno(fp), &st) == -1)
+		log_err("fstat %s", filename);
+
+	map = xzalloc(sizeof(*map), "failed to allocate memory for file map");
+	map->size = st.st_size;
+	map->dev = st.st_dev;
+	map->ino = st.st_ino;
+	map->fd = -1;
+
+#ifndef _MSC_VER
+	if (map->size != 0) {
+		void *addr = mmap(NULL, map->size, PROT_READ, MAP_PRIVATE,
+		    fileno(fp), 0);
+
+		if (addr != MAP_FAILED) {
+			/* Keep a descriptor to copy payloads from. */
+			map->fd = dup(fileno(fp));
+			if (map->fd == -1)
+				munmap(addr, map->size);
+			else
+				map->addr = addr;
+		}
+	}
+#endif
+	if (map->fd == -1) {
+		/* Allocate one byte at least so that addr is never NULL. */
+		map->addr = xmalloc(map->size + 1,
+		    "failed to load file into memory");
+		if (fread(map->addr, 1, map->size, fp) != map->size)
+			log_errx("Failed to read %s", filename);
+	}
+	fclose(fp);
+
+	map->next = file_map_head;
+	file_map_head = map;
+	return map;
+}
+
+static void unmap_files(void)
+{
+	file_map_t *map = file_map_head, *tmp;
+
+	while (map != NULL) {
+		tmp = map->next;
+#ifndef _MSC_VER
+		if (map->fd != -1) {
+			munmap(map->addr, map->size);
+			close(map->fd);
+		} else
+#endif
+			free(map->addr);
+		free(map);
+		map = tmp;
+	}
+	file_map_head = NULL;
+}
+
+#ifndef _MSC_VER
+/*
+ * Copy a mapped file to memory and move the payloads referencing it to the
+ * copy, so that the file can be truncated and rewritten.
+ */
+static void detach_file_map(file_map_t *map)
+{
+	image_desc_t *desc;
+	char *addr;
+
+	addr = xmalloc(map->size + 1, "failed to load file into memory");
+	memcpy(addr, map->addr, map->size);
+
+	for (desc = image_desc_head; desc != NULL; desc = desc->next) {
+		image_t *image = desc->image;
+
+		if (image != NULL && image->map == map)
+			image->buffer = addr +
+			    ((char *)image->buffer - (char *)map->addr);
+	}
+
+	munmap(map->addr, map->size);
+	close(map->fd);
+	map->addr = addr;
+	map->fd = -1;
+}
+#endif
+
+/*
+ * Open a file for writing. Payloads may still be mapped from the file being
+ * replaced, so they are copied to memory first. The file is rewritten in
+ * place, which keeps its links, owner and mode.
+ */
+static FILE *open_output(const char *filename)
+{
+	FILE *fp;
+#ifndef _MSC_VER
+	struct BLD_PLAT_STAT st;
+	file_map_t *map;
+
+	if (stat(filename, &st) == 0)
+		for (map = file_map_head; map != NULL; map = map->next)
+			if (map->fd != -1 && map->dev == st.st_dev &&
+			    map->ino == st.st_ino)
+				detach_file_map(map);
+#endif
+	fp = fopen(filename, "wb");
+	if (fp == NULL)
+		log_err("fopen %s", filename);
+	return fp;
+}
+
+/*
+ * Write the payload of an image at the given offset of the file. Payloads of
+ * mapped files are copied by the kernel where supported.
+ */
+static void write_image_data(const image_t *image, FILE *fp, uint64_t offset,
+    const char *filename)
+{
+	uint64_t done = 0;
+
+#ifdef HAVE_COPY_FILE_RANGE
+	if (image->map->fd != -1) {
+		char *base = image->map->addr;
+		loff_t off_in = (char *)image->buffer - base;
+		loff_t off_out = offset;
+		ssize_t ret;
+
+		/* Data buffered by stdio must reach the file first. */
+		if (fflush(fp) != 0)
+			log_err("fflush %s", filename);
+
+		while (done < image->toc_e.size) {
+			ret = copy_file_range(image->map->fd, &off_in,
+			    fileno(fp), &off_out, image->toc_e.size - done, 0);
+			if (ret <= 0)
+				break;
+			done += ret;
+		}
+	}
+#endif
+	if (done == image->toc_e.size)
+		return;
+
+	if (fseek(fp, offset + done, SEEK_SET))
+		log_errx("Failed to set file position");
+	xfwrite((char *)image->buffer + done, image->toc_e.size - done, fp,
+	    filename);
+}
+
 static image_desc_t *new_image_desc(const uuid_t *uuid,
     const char *name, const char *cmdline_name)
 {
@@ -166,26 +347,111 @@ static void set_image_desc_action(image_desc_t *desc, int action,
 
 static void free_image_desc(image_desc_t *desc)
 {
+	free(desc->action_arg);
+	free(desc->image);
+
+	/* Descriptors of the table point to the strings of toc_entries[]. */
+	if (desc >= image_desc_table &&
+	    desc < image_desc_table + nr_table_descs)
+		return;
+
 	free(desc->name);
 	free(desc->cmdline_name);
-	free(desc->action_arg);
-	if (desc->image) {
-		free(desc->image->buffer);
-		free(desc->image);
-	}
 	free(desc);
 }
 
-static void add_image_desc(image_desc_t *desc)
+/* FNV-1a hash. */
+static uint32_t hash_data(const void *data, size_t len)
 {
-	image_desc_t **p = &image_desc_head;
+	const unsigned char *p = data;
+	uint32_t hash = 2166136261U;
 
-	while (*p)
-		p = &(*p)->next;
+	while (len--) {
+		hash ^= *p++;
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+static int desc_has_uuid(const image_desc_t *desc, const void *uuid)
+{
+	return memcmp(&desc->uuid, uuid, sizeof(uuid_t)) == 0;
+}
+
+static int desc_has_opt(const image_desc_t *desc, const void *opt)
+{
+	return strcmp(desc->cmdline_name, opt) == 0;
+}
+
+static image_desc_t *desc_index_lookup(const desc_index_t *index,
+    uint32_t hash, const void *key,
+    int (*match)(const image_desc_t *, const void *))
+{
+	size_t mask, i;
+
+	if (index->size == 0)
+		return NULL;
+
+	mask = index->size - 1;
+	for (i = hash & mask; index->slots[i].desc != NULL; i = (i + 1) & mask)
+		if (index->slots[i].hash == hash &&
+		    match(index->slots[i].desc, key))
+			return index->slots[i].desc;
+	return NULL;
+}
+
+static void desc_index_insert(desc_index_t *index, uint32_t hash,
+    image_desc_t *desc)
+{
+	struct desc_index_slot *slots = index->slots;
+	size_t size = index->size, mask, i;
+
+	/* Keep the table at most half full. */
+	if ((index->count + 1) * 2 > size) {
+		index->size = (size == 0) ? 64 : size * 2;
+		index->slots = xzalloc(index->size * sizeof(*slots),
+		    "failed to allocate memory for descriptor index");
+		index->count = 0;
+		for (i = 0; i < size; i++)
+			if (slots[i].desc != NULL)
+				desc_index_insert(index, slots[i].hash,
+				    slots[i].desc);
+		free(slots);
+	}
+
+	mask = index->size - 1;
+	for (i = hash & mask; index->slots[i].desc != NULL; i = (i + 1) & mask)
+		;
+	index->slots[i].hash = hash;
+	index->slots[i].desc = desc;
+	index->count++;
+}
 
-	assert(*p == NULL);
-	*p = desc;
+static void desc_index_free(desc_index_t *index)
+{
+	free(index->slots);
+	memset(index, 0, sizeof(*index));
+}
+
+static void add_image_desc(image_desc_t *desc)
+{
+	uint32_t hash;
+
+	assert(*image_desc_tail == NULL);
+	*image_desc_tail = desc;
+	image_desc_tail = &desc->next;
 	nr_image_descs++;
+
+	/* Lookups return the first descriptor added with a given key. */
+	hash = hash_data(&desc->uuid, sizeof(uuid_t));
+	if (desc_index_lookup(&desc_by_uuid, hash, &desc->uuid,
+	    desc_has_uuid) == NULL)
+		desc_index_insert(&desc_by_uuid, hash, desc);
+
+	hash = hash_data(desc->cmdline_name, strlen(desc->cmdline_name));
+	if (desc_index_lookup(&desc_by_opt, hash, desc->cmdline_name,
+	    desc_has_opt) == NULL)
+		desc_index_insert(&desc_by_opt, hash, desc);
 }
 
 static void free_image_descs(void)
@@ -199,42 +465,52 @@ static void free_image_descs(void)
 		nr_image_descs--;
 	}
 	assert(nr_image_descs == 0);
+	image_desc_head = NULL;
+	image_desc_tail = &image_desc_head;
+
+	free(image_desc_table);
+	image_desc_table = NULL;
+	nr_table_descs = 0;
+	desc_index_free(&desc_by_uuid);
+	desc_index_free(&desc_by_opt);
 }
 
 static void fill_image_descs(void)
 {
 	toc_entry_t *toc_entry;
+	image_desc_t *desc;
+	size_t nr_entries = 0;
 
 	for (toc_entry = toc_entries;
 	     toc_entry->cmdline_name != NULL;
-	     toc_entry++) {
-		image_desc_t *desc;
+	     toc_entry++)
+		nr_entries++;
+
+	image_desc_table = xzalloc(nr_entries * sizeof(*image_desc_table),
+	    "failed to allocate memory for image descriptors");
+	nr_table_descs = nr_entries;
 
-		desc = new_image_desc(&toc_entry->uuid,
-		    toc_entry->name,
-		    toc_entry->cmdline_name);
+	for (toc_entry = toc_entries, desc = image_desc_table;
+	     toc_entry->cmdline_name != NULL;
+	     toc_entry++, desc++) {
+		memcpy(&desc->uuid, &toc_entry->uuid, sizeof(uuid_t));
+		desc->name = toc_entry->name;
+		desc->cmdline_name = toc_entry->cmdline_name;
+		desc->action = DO_UNSPEC;
 		add_image_desc(desc);
 	}
 }
 
 static image_desc_t *lookup_image_desc_from_uuid(const uuid_t *uuid)
 {
-	image_desc_t *desc;
-
-	for (desc = image_desc_head; desc != NULL; desc = desc->next)
-		if (memcmp(&desc->uuid, uuid, sizeof(uuid_t)) == 0)
-			return desc;
-	return NULL;
+	return desc_index_lookup(&desc_by_uuid,
+	    hash_data(uuid, sizeof(uuid_t)), uuid, desc_has_uuid);
 }
 
 static image_desc_t *lookup_image_desc_from_opt(const char *opt)
 {
-	image_desc_t *desc;
-
-	for (desc = image_desc_head; desc != NULL; desc = desc->next)
-		if (strcmp(desc->cmdline_name, opt) == 0)
-			return desc;
-	return NULL;
+	return desc_index_lookup(&desc_by_opt, hash_data(opt, strlen(opt)),
+	    opt, desc_has_opt);
 }
 
 static void uuid_to_str(char *s, size_t len, const uuid_t *u)
@@ -280,27 +556,18 @@ static void uuid_from_str(uuid_t *u, const char *s)
 
 static int parse_fip(const char *filename, fip_toc_header_t *toc_header_out)
 {
-	struct BLD_PLAT_STAT st;
-	FILE *fp;
+	file_map_t *map;
 	char *buf, *bufend;
 	fip_toc_header_t *toc_header;
 	fip_toc_entry_t *toc_entry;
 	int terminated = 0;
 
-	fp = fopen(filename, "rb");
-	if (fp == NULL)
-		log_err("fopen %s", filename);
-
-	if (fstat(fileno(fp), &st) == -1)
-		log_err("fstat %s", filename);
+	/* Images reference their payload in the mapped FIP. */
+	map = map_file(filename);
+	buf = map->addr;
+	bufend = buf + map->size;
 
-	buf = xmalloc(st.st_size, "failed to load file into memory");
-	if (fread(buf, 1, st.st_size, fp) != st.st_size)
-		log_errx("Failed to read %s", filename);
-	bufend = buf + st.st_size;
-	fclose(fp);
-
-	if (st.st_size < sizeof(fip_toc_header_t))
+	if (map->size < sizeof(fip_toc_header_t))
 		log_errx("FIP %s is truncated", filename);
 
 	toc_header = (fip_toc_header_t *)buf;
@@ -331,16 +598,14 @@ static int parse_fip(const char *filename, fip_toc_header_t *toc_header_out)
 		image = xzalloc(sizeof(*image),
 		    "failed to allocate memory for image");
 		image->toc_e = *toc_entry;
-		image->buffer = xmalloc(toc_entry->size,
-		    "failed to allocate image buffer, is FIP file corrupted?");
-		/* Overflow checks before memory copy. */
+		/* Overflow checks before referencing the payload. */
 		if (toc_entry->size > (uint64_t)-1 - toc_entry->offset_address)
 			log_errx("FIP %s is corrupted", filename);
-		if (toc_entry->size + toc_entry->offset_address > st.st_size)
+		if (toc_entry->size + toc_entry->offset_address > map->size)
 			log_errx("FIP %s is corrupted", filename);
 
-		memcpy(image->buffer, buf + toc_entry->offset_address,
-		    toc_entry->size);
+		image->buffer = buf + toc_entry->offset_address;
+		image->map = map;
 
 		/* If this is an unknown image, create a descriptor for it. */
 		desc = lookup_image_desc_from_uuid(&toc_entry->uuid);
@@ -366,34 +631,25 @@ static int parse_fip(const char *filename, fip_toc_header_t *toc_header_out)
 	if (terminated == 0)
 		log_errx("FIP %s does not have a ToC terminator entry",
 		    filename);
-	free(buf);
 	return 0;
 }
 
 static image_t *read_image_from_file(const uuid_t *uuid, const char *filename)
 {
-	struct BLD_PLAT_STAT st;
 	image_t *image;
-	FILE *fp;
+	file_map_t *map;
 
 	assert(uuid != NULL);
 	assert(filename != NULL);
 
-	fp = fopen(filename, "rb");
-	if (fp == NULL)
-		log_err("fopen %s", filename);
-
-	if (fstat(fileno(fp), &st) == -1)
-		log_errx("fstat %s", filename);
+	map = map_file(filename);
 
 	image = xzalloc(sizeof(*image), "failed to allocate memory for image");
 	image->toc_e.uuid = *uuid;
-	image->buffer = xmalloc(st.st_size, "failed to allocate image buffer");
-	if (fread(image->buffer, 1, st.st_size, fp) != st.st_size)
-		log_errx("Failed to read %s", filename);
-	image->toc_e.size = st.st_size;
+	image->buffer = map->addr;
+	image->map = map;
+	image->toc_e.size = map->size;
 
-	fclose(fp);
 	return image;
 }
 
@@ -401,10 +657,8 @@ static int write_image_to_file(const image_t *image, const char *filename)
 {
 	FILE *fp;
 
-	fp = fopen(filename, "wb");
-	if (fp == NULL)
-		log_err("fopen");
-	xfwrite(image->buffer, image->toc_e.size, fp, filename);
+	fp = open_output(filename);
+	write_image_data(image, fp, 0, filename);
 	fclose(fp);
 	return 0;
 }
@@ -442,14 +696,184 @@ static void md_print(const unsigned char *md, size_t len)
 		printf("%02x", md[i]);
 }
 
+#ifndef _MSC_VER	/* We don't have SHA256 for Visual Studio. */
+/* A buffer to hash by one of the digest threads. */
+typedef struct digest_job {
+	const unsigned char *data;
+	size_t               len;
+	unsigned char       *md;
+} digest_job_t;
+
+typedef struct digest_jobs {
+	pthread_mutex_t      lock;
+	digest_job_t        *jobs;
+	size_t               nr_jobs;
+	size_t               next;
+} digest_jobs_t;
+
+static void *digest_worker(void *arg)
+{
+	digest_jobs_t *jobs = arg;
+	digest_job_t *job;
+
+	while (1) {
+		pthread_mutex_lock(&jobs->lock);
+		job = (jobs->next < jobs->nr_jobs) ?
+		    &jobs->jobs[jobs->next++] : NULL;
+		pthread_mutex_unlock(&jobs->lock);
+		if (job == NULL)
+			break;
+		SHA256(job->data, job->len, job->md);
+	}
+	return NULL;
+}
+
+/* Start with the largest buffers, for the threads to finish together. */
+static int cmp_digest_jobs(const void *a, const void *b)
+{
+	const digest_job_t *ja = a, *jb = b;
+
+	return (ja->len < jb->len) - (ja->len > jb->len);
+}
+
+/*
+ * Compute the SHA-256 of the payload of each image on nr_threads threads.
+ * With 'tree', the payloads are instead split in chunks of
+ * TREE_HASH_CHUNK_SIZE bytes, hashed in parallel, and the SHA-256 of the
+ * concatenated digests of the chunks is computed.
+ */
+static void digest_images(image_t **images, image_digest_t *digests,
+    size_t nr_images, int tree, long nr_threads)
+{
+	digest_jobs_t jobs = { .lock = PTHREAD_MUTEX_INITIALIZER };
+	pthread_t *threads;
+	size_t i, j, nr_chunks = 0;
+	long nr_started;
+
+	for (i = 0; i < nr_images && tree; i++) {
+		digests[i].nr_chunks = (images[i]->toc_e.size +
+		    TREE_HASH_CHUNK_SIZE - 1) / TREE_HASH_CHUNK_SIZE;
+		digests[i].chunk_sha256 = xmalloc(digests[i].nr_chunks *
+		    SHA256_DIGEST_LENGTH + 1,
+		    "failed to allocate memory for digests");
+		nr_chunks += digests[i].nr_chunks;
+	}
+
+	jobs.jobs = xmalloc((tree ? nr_chunks : nr_images) *
+	    sizeof(*jobs.jobs) + 1, "failed to allocate memory for digests");
+	for (i = 0; i < nr_images; i++) {
+		digest_job_t *job;
+
+		if (!tree) {
+			job = &jobs.jobs[jobs.nr_jobs++];
+			job->data = images[i]->buffer;
+			job->len = images[i]->toc_e.size;
+			job->md = digests[i].sha256;
+		}
+
+		for (j = 0; j < digests[i].nr_chunks; j++) {
+			uint64_t offset = (uint64_t)j * TREE_HASH_CHUNK_SIZE;
+
+			job = &jobs.jobs[jobs.nr_jobs++];
+			job->data = (unsigned char *)images[i]->buffer + offset;
+			job->len = images[i]->toc_e.size - offset;
+			if (job->len > TREE_HASH_CHUNK_SIZE)
+				job->len = TREE_HASH_CHUNK_SIZE;
+			job->md = digests[i].chunk_sha256 +
+			    j * SHA256_DIGEST_LENGTH;
+		}
+	}
+	qsort(jobs.jobs, jobs.nr_jobs, sizeof(*jobs.jobs), cmp_digest_jobs);
+
+	if (nr_threads > (long)jobs.nr_jobs)
+		nr_threads = jobs.nr_jobs;
+	threads = xzalloc((nr_threads + 1) * sizeof(*threads),
+	    "failed to allocate memory for threads");
+
+	/* The calling thread is one of the workers. */
+	for (nr_started = 1; nr_started < nr_threads; nr_started++)
+		if (pthread_create(&threads[nr_started], NULL, digest_worker,
+		    &jobs) != 0)
+			break;
+	digest_worker(&jobs);
+	while (--nr_started > 0)
+		pthread_join(threads[nr_started], NULL);
+
+	for (i = 0; i < nr_images && tree; i++)
+		SHA256(digests[i].chunk_sha256,
+		    digests[i].nr_chunks * SHA256_DIGEST_LENGTH,
+		    digests[i].tree_sha256);
+
+	free(threads);
+	free(jobs.jobs);
+	pthread_mutex_destroy(&jobs.lock);
+}
+#endif
+
+static void json_print_str(const char *s)
+{
+	putchar('"');
+	for (; *s != '\0'; s++) {
+		if (*s == '"' || *s == '\\')
+			printf("\\%c", *s);
+		else if ((unsigned char)*s < 0x20)
+			printf("\\u%04x", *s);
+		else
+			putchar(*s);
+	}
+	putchar('"');
+}
+
 static int info_cmd(int argc, char *argv[])
 {
+	struct option *opts = NULL;
+	size_t nr_opts = 0;
 	image_desc_t *desc;
 	fip_toc_header_t toc_header;
+	image_t **images;
+	image_digest_t *digests;
+	char uuid[_UUID_STR_LEN + 1];
+	size_t i, nr_images = 0;
+	int json = 0, tree = 0, digest = 0;
+	long nr_threads = 0;
+
+	opts = add_opt(opts, &nr_opts, "jobs", required_argument, 'j');
+	opts = add_opt(opts, &nr_opts, "json", no_argument, OPT_JSON);
+	opts = add_opt(opts, &nr_opts, "tree-hash", no_argument,
+	    OPT_TREE_HASH);
+	opts = add_opt(opts, &nr_opts, NULL, 0, 0);
+
+	while (1) {
+		int c, opt_index = 0;
+		char *endptr;
+
+		c = getopt_long(argc, argv, "j:", opts, &opt_index);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'j':
+			errno = 0;
+			nr_threads = strtol(optarg, &endptr, 0);
+			if (*endptr != '\0' || nr_threads < 1 || errno != 0)
+				log_errx("Invalid number of jobs: %s", optarg);
+			break;
+		case OPT_JSON:
+			json = 1;
+			break;
+		case OPT_TREE_HASH:
+			tree = 1;
+			break;
+		default:
+			info_usage();
+		}
+	}
+	argc -= optind;
+	argv += optind;
+	free(opts);
 
-	if (argc != 2)
+	if (argc != 1)
 		info_usage();
-	argc--, argv++;
 
 	parse_fip(argv[0], &toc_header);
 
@@ -462,34 +886,88 @@ static int info_cmd(int argc, char *argv[])
 		    (unsigned long long)toc_header.flags);
 	}
 
-	for (desc = image_desc_head; desc != NULL; desc = desc->next) {
-		image_t *image = desc->image;
+	images = xzalloc(nr_image_descs * sizeof(*images),
+	    "failed to allocate memory for images");
+	digests = xzalloc(nr_image_descs * sizeof(*digests),
+	    "failed to allocate memory for digests");
+	for (desc = image_desc_head; desc != NULL; desc = desc->next)
+		if (desc->image != NULL)
+			images[nr_images++] = desc->image;
 
-		if (image == NULL)
-			continue;
-		printf("%s: offset=0x%llX, size=0x%llX, cmdline=\"--%s\"",
-		       desc->name,
-		       (unsigned long long)image->toc_e.offset_address,
-		       (unsigned long long)image->toc_e.size,
-		       desc->cmdline_name);
 #ifndef _MSC_VER	/* We don't have SHA256 for Visual Studio. */
-		if (verbose) {
-			unsigned char md[SHA256_DIGEST_LENGTH];
+	digest = verbose || json || tree;
+	if (digest) {
+		if (nr_threads == 0)
+			nr_threads = sysconf(_SC_NPROCESSORS_ONLN);
+		if (nr_threads < 1)
+			nr_threads = 1;
+		digest_images(images, digests, nr_images, tree, nr_threads);
+	}
+#endif
+
+	if (json)
+		printf("{\n  \"toc_header\": { \"name\": %llu, "
+		    "\"serial_number\": %llu, \"flags\": %llu },\n"
+		    "  \"images\": [",
+		    (unsigned long long)toc_header.name,
+		    (unsigned long long)toc_header.serial_number,
+		    (unsigned long long)toc_header.flags);
 
-			SHA256(image->buffer, image->toc_e.size, md);
-			printf(", sha256=");
-			md_print(md, sizeof(md));
+	for (i = 0; i < nr_images; i++) {
+		image_t *image = images[i];
+
+		desc = lookup_image_desc_from_uuid(&image->toc_e.uuid);
+		if (json) {
+			uuid_to_str(uuid, sizeof(uuid), &desc->uuid);
+			printf("%s\n    { \"name\": ", (i == 0) ? "" : ",");
+			json_print_str(desc->name);
+			printf(", \"uuid\": \"%s\", \"cmdline\": ", uuid);
+			json_print_str(desc->cmdline_name);
+			printf(", \"offset\": %llu, \"size\": %llu",
+			    (unsigned long long)image->toc_e.offset_address,
+			    (unsigned long long)image->toc_e.size);
+		} else {
+			printf("%s: offset=0x%llX, size=0x%llX, "
+			    "cmdline=\"--%s\"",
+			    desc->name,
+			    (unsigned long long)image->toc_e.offset_address,
+			    (unsigned long long)image->toc_e.size,
+			    desc->cmdline_name);
 		}
-#endif
-		putchar('\n');
+
+		if (digest && tree) {
+			printf(json ? ", \"tree_sha256\": \"" :
+			    ", tree_sha256=");
+			md_print(digests[i].tree_sha256, SHA256_DIGEST_LENGTH);
+		} else if (digest) {
+			printf(json ? ", \"sha256\": \"" : ", sha256=");
+			md_print(digests[i].sha256, SHA256_DIGEST_LENGTH);
+		}
+		if (digest && json)
+			putchar('"');
+
+		printf(json ? " }" : "\n");
+		free(digests[i].chunk_sha256);
 	}
 
+	if (json)
+		printf("\n  ]\n}\n");
+
+	free(digests);
+	free(images);
 	return 0;
 }
 
 static void info_usage(void)
 {
-	printf("fiptool info FIP_FILENAME\n");
+	printf("fiptool info [opts] FIP_FILENAME\n");
+	printf("\n");
+	printf("Options:\n");
+	printf("  --jobs <value>\tNumber of threads computing digests (default: number of CPUs).\n");
+	printf("  --json\t\tPrint the images in JSON format, with their SHA-256.\n");
+	printf("  --tree-hash\t\tPrint the SHA-256 of the SHA-256 of each 1 MiB chunk of the images, instead of their SHA-256.\n");
+	printf("\n");
+	printf("With --verbose, the SHA-256 of each image is printed.\n");
 	exit(1);
 }
 
@@ -543,9 +1021,7 @@ static int pack_images(const char *filename, uint64_t toc_flags, unsigned long a
 	toc_entry->offset_address = (entry_offset + align - 1) & ~(align - 1);
 
 	/* Generate the FIP file. */
-	fp = fopen(filename, "wb");
-	if (fp == NULL)
-		log_err("fopen %s", filename);
+	fp = open_output(filename);
 
 	if (verbose)
 		log_dbgx("Metadata size: %zu bytes", buf_size);
@@ -560,10 +1036,8 @@ static int pack_images(const char *filename, uint64_t toc_flags, unsigned long a
 
 		if (image == NULL)
 			continue;
-		if (fseek(fp, image->toc_e.offset_address, SEEK_SET))
-			log_errx("Failed to set file position");
-
-		xfwrite(image->buffer, image->toc_e.size, fp, filename);
+		write_image_data(image, fp, image->toc_e.offset_address,
+		    filename);
 	}
 
 	if (fseek(fp, entry_offset, SEEK_SET))
@@ -615,6 +1089,185 @@ static void update_fip(void)
 	}
 }
 
+#ifndef _MSC_VER
+/* Return the ToC entry with the given UUID in a mapped FIP. */
+static fip_toc_entry_t *find_fip_toc_entry(const file_map_t *map,
+    const uuid_t *uuid)
+{
+	fip_toc_entry_t *toc_entry;
+
+	toc_entry = (fip_toc_entry_t *)((fip_toc_header_t *)map->addr + 1);
+	while (memcmp(&toc_entry->uuid, uuid, sizeof(uuid_t)) != 0)
+		toc_entry++;
+	return toc_entry;
+}
+
+static uint64_t image_end(const image_t *image)
+{
+	return image->toc_e.offset_address + image->toc_e.size;
+}
+
+/* Return whether the payloads of two images overlap. */
+static int images_overlap(const image_t *a, const image_t *b)
+{
+	if (a->toc_e.size == 0 || b->toc_e.size == 0)
+		return 0;
+	return a->toc_e.offset_address < image_end(b) &&
+	    b->toc_e.offset_address < image_end(a);
+}
+
+/*
+ * Update a FIP parsed by parse_fip() without rewriting it. This is possible
+ * when every image to replace is already in the FIP and its new payload fits
+ * before the next payload, or is the last payload of the FIP. Only the ToC
+ * and the new payloads are written. The unused end of a slot keeps its
+ * previous contents.
+ *
+ * Return 0 on success, or -1 if the FIP has to be rewritten instead, in
+ * which case it has not been modified.
+ */
+static int update_fip_in_place(const char *filename, uint64_t toc_flags,
+    unsigned long align)
+{
+	image_desc_t *desc, *other;
+	image_t **images, *image, *other_image;
+	fip_toc_header_t toc_header;
+	fip_toc_entry_t toc_entry, *fip_toc_entry;
+	file_map_t *fip_map = NULL;
+	uint64_t old_end = 0, new_end = 0, fip_size;
+	size_t i, j;
+	FILE *fp;
+	int ret = 0;
+
+	images = xzalloc(nr_image_descs * sizeof(*images),
+	    "failed to allocate memory for images");
+
+	/* New images take the place of the current ones. */
+	for (desc = image_desc_head, i = 0; desc != NULL;
+	     desc = desc->next, i++) {
+		if (desc->image == NULL)
+			continue;
+
+		if (image_end(desc->image) > old_end)
+			old_end = image_end(desc->image);
+		fip_map = desc->image->map;
+		if (desc->action != DO_PACK)
+			continue;
+
+		images[i] = read_image_from_file(&desc->uuid,
+		    desc->action_arg);
+		images[i]->toc_e.offset_address =
+		    desc->image->toc_e.offset_address;
+	}
+
+	/* Check that no payloads overlap in the new layout. */
+	for (desc = image_desc_head, i = 0; desc != NULL && ret == 0;
+	     desc = desc->next, i++) {
+		if (desc->action != DO_PACK)
+			continue;
+
+		if (desc->image == NULL) {
+			if (verbose)
+				log_dbgx("%s is not in %s",
+				    desc->cmdline_name, filename);
+			ret = -1;
+			break;
+		}
+
+		image = images[i];
+		for (other = image_desc_head, j = 0; other != NULL;
+		     other = other->next, j++) {
+			other_image = (images[j] != NULL) ? images[j] :
+			    other->image;
+			if (other == desc || other_image == NULL ||
+			    !images_overlap(image, other_image))
+				continue;
+			if (verbose)
+				log_dbgx("%s does not fit in place",
+				    desc->action_arg);
+			ret = -1;
+			break;
+		}
+	}
+
+	if (ret != 0 || fip_map == NULL) {
+		for (i = 0; i < nr_image_descs; i++)
+			free(images[i]);
+		free(images);
+		return -1;
+	}
+
+	fp = fopen(filename, "r+b");
+	if (fp == NULL)
+		log_err("fopen %s", filename);
+
+	toc_header = *(fip_toc_header_t *)fip_map->addr;
+	toc_header.flags = toc_flags;
+	xfwrite(&toc_header, sizeof(toc_header), fp, filename);
+
+	/* Write the new payloads and their ToC entries. */
+	for (desc = image_desc_head, i = 0; desc != NULL;
+	     desc = desc->next, i++) {
+		image = images[i];
+		if (image == NULL)
+			continue;
+
+		if (verbose)
+			log_dbgx("Replacing %s with %s in place",
+			    desc->cmdline_name, desc->action_arg);
+
+		fip_toc_entry = find_fip_toc_entry(fip_map, &desc->uuid);
+		toc_entry = *fip_toc_entry;
+		toc_entry.size = image->toc_e.size;
+		image->toc_e = toc_entry;
+
+		write_image_data(image, fp, toc_entry.offset_address,
+		    filename);
+		if (fseek(fp, (char *)fip_toc_entry - (char *)fip_map->addr,
+		    SEEK_SET))
+			log_errx("Failed to set file position");
+		xfwrite(&toc_entry, sizeof(toc_entry), fp, filename);
+
+		free(desc->image);
+		desc->image = image;
+	}
+
+	/*
+	 * If the last payload changed size, so does the FIP. The ToC
+	 * terminator offset must match the FIP size, and the padding after
+	 * the last payload is cleared by truncating the file before extending
+	 * it.
+	 */
+	for (desc = image_desc_head; desc != NULL; desc = desc->next)
+		if (desc->image != NULL && image_end(desc->image) > new_end)
+			new_end = image_end(desc->image);
+
+	if (new_end != old_end) {
+		fip_size = (new_end + align - 1) & ~(align - 1);
+		if (verbose)
+			log_dbgx("Resizing %s to %llu bytes", filename,
+			    (unsigned long long)fip_size);
+
+		fip_toc_entry = find_fip_toc_entry(fip_map, &uuid_null);
+		memset(&toc_entry, 0, sizeof(toc_entry));
+		toc_entry.offset_address = fip_size;
+		if (fseek(fp, (char *)fip_toc_entry - (char *)fip_map->addr,
+		    SEEK_SET))
+			log_errx("Failed to set file position");
+		xfwrite(&toc_entry, sizeof(toc_entry), fp, filename);
+
+		if (fflush(fp) != 0 || ftruncate(fileno(fp), new_end) == -1 ||
+		    ftruncate(fileno(fp), fip_size) == -1)
+			log_err("ftruncate %s", filename);
+	}
+
+	if (fclose(fp) != 0)
+		log_err("fclose %s", filename);
+	free(images);
+	return 0;
+}
+#endif
+
 static void parse_plat_toc_flags(const char *arg, unsigned long long *toc_flags)
 {
 	unsigned long long flags;
@@ -764,7 +1417,7 @@ static int update_cmd(int argc, char *argv[])
 	fip_toc_header_t toc_header = { 0 };
 	unsigned long long toc_flags = 0;
 	unsigned long align = 1;
-	int pflag = 0;
+	int pflag = 0, in_place = 0;
 
 	if (argc < 2)
 		update_usage();
@@ -772,6 +1425,7 @@ static int update_cmd(int argc, char *argv[])
 	opts = fill_common_opts(opts, &nr_opts, required_argument);
 	opts = add_opt(opts, &nr_opts, "align", required_argument, OPT_ALIGN);
 	opts = add_opt(opts, &nr_opts, "blob", required_argument, 'b');
+	opts = add_opt(opts, &nr_opts, "in-place", no_argument, OPT_IN_PLACE);
 	opts = add_opt(opts, &nr_opts, "out", required_argument, 'o');
 	opts = add_opt(opts, &nr_opts, "plat-toc-flags", required_argument,
 	    OPT_PLAT_TOC_FLAGS);
@@ -821,6 +1475,9 @@ static int update_cmd(int argc, char *argv[])
 		case OPT_ALIGN:
 			align = get_image_align(optarg);
 			break;
+		case OPT_IN_PLACE:
+			in_place = 1;
+			break;
 		case 'o':
 			snprintf(outfile, sizeof(outfile), "%s", optarg);
 			break;
@@ -840,11 +1497,21 @@ static int update_cmd(int argc, char *argv[])
 
 	if (access(argv[0], F_OK) == 0)
 		parse_fip(argv[0], &toc_header);
+	else
+		in_place = 0;
 
 	if (pflag)
 		toc_header.flags &= ~(0xffffULL << 32);
 	toc_flags = (toc_header.flags |= toc_flags);
 
+#ifndef _MSC_VER
+	if (in_place && strcmp(outfile, argv[0]) == 0 &&
+	    update_fip_in_place(argv[0], toc_flags, align) == 0)
+		return 0;
+	if (in_place)
+		log_warnx("Cannot update %s in place, rewriting it", argv[0]);
+#endif
+
 	update_fip();
 
 	pack_images(outfile, toc_flags, align);
@@ -860,6 +1527,7 @@ static void update_usage(void)
 	printf("Options:\n");
 	printf("  --align <value>\t\tEach image is aligned to <value> (default: 1).\n");
 	printf("  --blob uuid=...,file=...\tAdd or update an image with the given UUID pointed to by file.\n");
+	printf("  --in-place\t\t\tOnly write the new images and the ToC when they fit in the FIP.\n");
 	printf("  --out FIP_FILENAME\t\tSet an alternative output FIP file.\n");
 	printf("  --plat-toc-flags <value>\t16-bit platform specific flag field occupying bits 32-47 in 64-bit ToC header.\n");
 	printf("\n");
@@ -1226,5 +1894,6 @@ int main(int argc, char *argv[])
 	if (i == NELEM(cmds))
 		usage();
 	free_image_descs();
+	unmap_files();
 	return ret;
 }
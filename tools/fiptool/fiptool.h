@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2016-2017, ARM Limited and Contributors. All rights reserved.
+ * Copyright (c) 2016-2020, ARM Limited and Contributors. All rights reserved.
  *
  * SPDX-License-Identifier: BSD-3-Clause
  */
@@ -7,6 +7,8 @@
 #ifndef __FIPTOOL_H__
 #define __FIPTOOL_H__
 
+#include <sys/types.h>
+
 #include <stddef.h>
 #include <stdint.h>
 
@@ -40,11 +42,40 @@ typedef struct image_desc {
 	struct image_desc *next;
 } image_desc_t;
 
+/* Open addressing hash table of image descriptors. */
+typedef struct desc_index {
+	struct desc_index_slot {
+		uint32_t           hash;
+		struct image_desc *desc;
+	}                  *slots;
+	size_t              size;	/* Power of 2, or 0 */
+	size_t              count;
+} desc_index_t;
+
+/* File contents, mapped in memory where possible, shared by its images. */
+typedef struct file_map {
+	void               *addr;
+	size_t              size;
+	int                 fd;		/* -1 if the file was read to memory */
+	dev_t               dev;
+	ino_t               ino;
+	struct file_map    *next;
+} file_map_t;
+
 typedef struct image {
 	struct fip_toc_entry toc_e;
-	void                *buffer;
+	void                *buffer;	/* Slice of map, not allocated */
+	file_map_t          *map;
 } image_t;
 
+/* Digests of an image payload, see info_cmd(). */
+typedef struct image_digest {
+	unsigned char       sha256[32];
+	unsigned char       tree_sha256[32];
+	unsigned char      *chunk_sha256;	/* 32 bytes per chunk */
+	size_t              nr_chunks;
+} image_digest_t;
+
 typedef struct cmd {
 	char              *name;
 	int              (*handler)(int, char **);
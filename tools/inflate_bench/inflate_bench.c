@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2020, ARM Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/*
+ * Host benchmark of the lib/zlib inflate path used by gunzip(). It is linked
+ * twice by the Makefile, with the stock inffast.c and with tf_inffast.c, so
+ * that running both binaries on the same compressed BL33 or kernel images
+ * gives the gain of ZLIB_FAST_INFLATE. Cross-compile it to measure a target
+ * CPU.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "zlib.h"
+
+#define DEFAULT_RUNS	10
+
+/* windowBits for a gzip stream with a 32KB window, as DEF_WBITS in TF-A */
+#define GZIP_WBITS	31
+
+static void *bench_zalloc(void *opaque, unsigned int items, unsigned int size)
+{
+	return calloc(items, size);
+}
+
+static void bench_zfree(void *opaque, void *ptr)
+{
+	free(ptr);
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int read_file(const char *name, unsigned char **buf, size_t *len)
+{
+	FILE *fp;
+	long size;
+	int ret = -1;
+
+	fp = fopen(name, "rb");
+	if (fp == NULL) {
+		fprintf(stderr, "Can't open %s: %s\n", name, strerror(errno));
+		return -1;
+	}
+
+	if ((fseek(fp, 0L, SEEK_END) != 0) || ((size = ftell(fp)) < 0L) ||
+	    (fseek(fp, 0L, SEEK_SET) != 0)) {
+		fprintf(stderr, "Can't get the size of %s\n", name);
+		goto out;
+	}
+
+	*buf = malloc(size);
+	if (*buf == NULL) {
+		fprintf(stderr, "Can't allocate %ld bytes\n", size);
+		goto out;
+	}
+
+	if (fread(*buf, 1, size, fp) != (size_t)size) {
+		fprintf(stderr, "Read error on %s\n", name);
+		free(*buf);
+		goto out;
+	}
+
+	*len = size;
+	ret = 0;
+out:
+	fclose(fp);
+
+	return ret;
+}
+
+/*
+ * Decompress the whole gzip stream in one call, as gunzip() does. inflate()
+ * checks the CRC32 and size of the trailer, so a wrong output fails here.
+ */
+static int inflate_once(const unsigned char *in, size_t in_len,
+			unsigned char *out, size_t out_len)
+{
+	z_stream stream;
+	int zret;
+
+	memset(&stream, 0, sizeof(stream));
+	stream.zalloc = bench_zalloc;
+	stream.zfree = bench_zfree;
+	stream.next_in = (unsigned char *)in;
+	stream.avail_in = in_len;
+	stream.next_out = out;
+	stream.avail_out = out_len;
+
+	if (inflateInit2(&stream, GZIP_WBITS) != Z_OK) {
+		return -1;
+	}
+
+	zret = inflate(&stream, Z_FINISH);
+	inflateEnd(&stream);
+
+	if ((zret != Z_STREAM_END) || (stream.total_out != out_len)) {
+		return -1;
+	}
+
+	return 0;
+}
+
+static int bench_file(const char *name, unsigned int runs)
+{
+	unsigned char *in, *out;
+	size_t in_len, out_len;
+	uint64_t t, best = UINT64_MAX;
+	unsigned int i;
+	int ret = -1;
+
+	if (read_file(name, &in, &in_len) != 0) {
+		return -1;
+	}
+
+	/* The gzip trailer ends with the output size, modulo 2^32 */
+	if (in_len < 18U) {
+		fprintf(stderr, "%s is not a gzip file\n", name);
+		goto out_in;
+	}
+	out_len = (size_t)in[in_len - 4U] |
+		  ((size_t)in[in_len - 3U] << 8) |
+		  ((size_t)in[in_len - 2U] << 16) |
+		  ((size_t)in[in_len - 1U] << 24);
+
+	out = malloc(out_len + 1U);
+	if (out == NULL) {
+		fprintf(stderr, "Can't allocate %zu bytes\n", out_len);
+		goto out_in;
+	}
+
+	for (i = 0U; i < runs; i++) {
+		t = now_ns();
+		if (inflate_once(in, in_len, out, out_len) != 0) {
+			fprintf(stderr, "%s: decompression failed\n", name);
+			goto out_out;
+		}
+		t = now_ns() - t;
+		if (t < best) {
+			best = t;
+		}
+	}
+
+	printf("%s: %zu -> %zu bytes, best of %u: %llu us, %.1f MB/s\n",
+	       name, in_len, out_len, runs,
+	       (unsigned long long)(best / 1000U),
+	       (double)out_len * 1000.0 / (double)best);
+	ret = 0;
+out_out:
+	free(out);
+out_in:
+	free(in);
+
+	return ret;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "Usage : %s [-n runs] file.gz...\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int runs = DEFAULT_RUNS;
+	int opt, i, ret = 0;
+
+	while ((opt = getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			runs = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return -1;
+		}
+	}
+
+	if ((runs == 0U) || (optind >= argc)) {
+		usage(argv[0]);
+		return -1;
+	}
+
+	for (i = optind; i < argc; i++) {
+		if (bench_file(argv[i], runs) != 0) {
+			ret = -1;
+		}
+	}
+
+	return ret;
+}
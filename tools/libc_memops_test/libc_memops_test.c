@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) 2020, ARM Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/*
+ * Host test of the memcpy(), memmove() and memset() of lib/libc built with
+ * LIBC_OPTIMIZED_MEMOPS=1, against the host C library:
+ * - every source and destination offset within two words,
+ * - lengths 0 to 256 and a few large ones,
+ * - overlapping moves in both directions.
+ * Guard bytes around the destination must be left untouched. With -b, the
+ * routines are timed against the byte-wise ones (LIBC_OPTIMIZED_MEMOPS=0).
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* lib/libc routines, renamed by the Makefile */
+void *tf_memcpy(void *dst, const void *src, size_t len);
+void *tf_memmove(void *dst, const void *src, size_t len);
+void *tf_memset(void *dst, int val, size_t count);
+void *byte_memcpy(void *dst, const void *src, size_t len);
+void *byte_memmove(void *dst, const void *src, size_t len);
+void *byte_memset(void *dst, int val, size_t count);
+
+#define MAX_SMALL_LEN	256U
+#define MAX_OFFSET	(2U * sizeof(uintptr_t))
+#define MAX_SHIFT	40
+#define GUARD		64U
+#define BUF_SIZE	(2U * (MAX_LARGE_LEN + GUARD))
+#define MAX_LARGE_LEN	(1024U * 1024U + 5U)
+
+static const size_t large_lens[] = { 1000U, 4096U + 5U, 65536U + 7U,
+				     MAX_LARGE_LEN };
+
+static unsigned char *src_buf, *test_buf, *ref_buf;
+
+static void fill_random(unsigned char *buf, size_t len)
+{
+	size_t i;
+
+	for (i = 0U; i < len; i++) {
+		buf[i] = (unsigned char)rand();
+	}
+}
+
+static int check_memcpy_case(size_t src_off, size_t dst_off, size_t len)
+{
+	size_t span = len + 2U * GUARD;
+	void *ret;
+
+	memset(test_buf, 0xA5, span);
+	memset(ref_buf, 0xA5, span);
+
+	ret = tf_memcpy(test_buf + GUARD + dst_off, src_buf + src_off, len);
+	memcpy(ref_buf + GUARD + dst_off, src_buf + src_off, len);
+
+	return (ret != test_buf + GUARD + dst_off) ||
+	       (memcmp(test_buf, ref_buf, span) != 0);
+}
+
+static int check_memcpy(void)
+{
+	size_t src_off, dst_off, len, i;
+	int fails = 0;
+
+	for (src_off = 0U; src_off < MAX_OFFSET; src_off++) {
+		for (dst_off = 0U; dst_off < MAX_OFFSET; dst_off++) {
+			for (len = 0U; len <= MAX_SMALL_LEN; len++) {
+				fails += check_memcpy_case(src_off, dst_off,
+							   len);
+			}
+			for (i = 0U; i < (sizeof(large_lens) /
+					  sizeof(large_lens[0])); i++) {
+				fails += check_memcpy_case(src_off, dst_off,
+							   large_lens[i]);
+			}
+		}
+	}
+
+	return fails;
+}
+
+/*
+ * Move len bytes within a buffer, from src_off to src_off + shift: negative
+ * shifts overlap the source from below, positive ones from above.
+ */
+static int check_memmove_case(size_t src_off, long shift, size_t len)
+{
+	size_t span = 2U * len + 4U * GUARD;
+	size_t src = 2U * GUARD + src_off;
+	void *ret;
+
+	fill_random(test_buf, span);
+	memcpy(ref_buf, test_buf, span);
+
+	ret = tf_memmove(test_buf + src + shift, test_buf + src, len);
+	memmove(ref_buf + src + shift, ref_buf + src, len);
+
+	return (ret != test_buf + src + shift) ||
+	       (memcmp(test_buf, ref_buf, span) != 0);
+}
+
+static int check_memmove(void)
+{
+	static const long large_shifts[] = {
+		-17, -8, -1, 1, 8, 17,
+	};
+	size_t src_off, len, i, j;
+	long shift;
+	int fails = 0;
+
+	for (src_off = 0U; src_off < MAX_OFFSET; src_off++) {
+		for (len = 0U; len <= MAX_SMALL_LEN; len++) {
+			for (shift = -MAX_SHIFT; shift <= MAX_SHIFT; shift++) {
+				fails += check_memmove_case(src_off, shift,
+							    len);
+			}
+		}
+		for (i = 0U; i < (sizeof(large_lens) / sizeof(large_lens[0]));
+		     i++) {
+			for (j = 0U; j < (sizeof(large_shifts) /
+					  sizeof(large_shifts[0])); j++) {
+				fails += check_memmove_case(src_off,
+							    large_shifts[j],
+							    large_lens[i]);
+			}
+		}
+	}
+
+	return fails;
+}
+
+static int check_memset_case(size_t dst_off, int val, size_t len)
+{
+	size_t span = len + 2U * GUARD;
+	void *ret;
+
+	memset(test_buf, 0xA5, span);
+	memset(ref_buf, 0xA5, span);
+
+	ret = tf_memset(test_buf + GUARD + dst_off, val, len);
+	memset(ref_buf + GUARD + dst_off, val, len);
+
+	return (ret != test_buf + GUARD + dst_off) ||
+	       (memcmp(test_buf, ref_buf, span) != 0);
+}
+
+static int check_memset(void)
+{
+	/* 0x1A5 and -1 check that only the low byte is used */
+	static const int vals[] = { 0x00, 0xFF, 0x5A, 0x1A5, -1 };
+	size_t dst_off, len, i, j;
+	int fails = 0;
+
+	for (dst_off = 0U; dst_off < MAX_OFFSET; dst_off++) {
+		for (j = 0U; j < (sizeof(vals) / sizeof(vals[0])); j++) {
+			for (len = 0U; len <= MAX_SMALL_LEN; len++) {
+				fails += check_memset_case(dst_off, vals[j],
+							   len);
+			}
+			for (i = 0U; i < (sizeof(large_lens) /
+					  sizeof(large_lens[0])); i++) {
+				fails += check_memset_case(dst_off, vals[j],
+							   large_lens[i]);
+			}
+		}
+	}
+
+	return fails;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+typedef void *(*copy_fn_t)(void *dst, const void *src, size_t len);
+
+/* Best time of a few rounds copying about 64MB, in ns per call */
+static double time_copy(copy_fn_t fn, size_t src_off, size_t dst_off,
+			size_t len)
+{
+	size_t i, calls = (64U * 1024U * 1024U) / len;
+	uint64_t t, best = UINT64_MAX;
+	int round;
+
+	for (round = 0; round < 5; round++) {
+		t = now_ns();
+		for (i = 0U; i < calls; i++) {
+			fn(test_buf + dst_off, src_buf + src_off, len);
+		}
+		t = now_ns() - t;
+		if (t < best) {
+			best = t;
+		}
+	}
+
+	return (double)best / (double)calls;
+}
+
+static double time_set(size_t dst_off, size_t len, int optimized)
+{
+	size_t i, calls = (64U * 1024U * 1024U) / len;
+	uint64_t t, best = UINT64_MAX;
+	int round;
+
+	for (round = 0; round < 5; round++) {
+		t = now_ns();
+		for (i = 0U; i < calls; i++) {
+			if (optimized) {
+				tf_memset(test_buf + dst_off, 0x5A, len);
+			} else {
+				byte_memset(test_buf + dst_off, 0x5A, len);
+			}
+		}
+		t = now_ns() - t;
+		if (t < best) {
+			best = t;
+		}
+	}
+
+	return (double)best / (double)calls;
+}
+
+static void benchmark(void)
+{
+	static const size_t lens[] = { 16U, 256U, 4096U, 1024U * 1024U };
+	static const size_t offs[][2] = { { 0U, 0U }, { 1U, 1U }, { 0U, 1U } };
+	double byte, opt;
+	size_t i, j;
+
+	printf("%-8s %8s %7s %12s %12s %7s\n", "routine", "length",
+	       "src/dst", "byte ns", "opt ns", "speedup");
+
+	for (i = 0U; i < (sizeof(lens) / sizeof(lens[0])); i++) {
+		for (j = 0U; j < (sizeof(offs) / sizeof(offs[0])); j++) {
+			byte = time_copy(byte_memcpy, offs[j][0], offs[j][1],
+					 lens[i]);
+			opt = time_copy(tf_memcpy, offs[j][0], offs[j][1],
+					lens[i]);
+			printf("%-8s %8zu %3zu/%-3zu %12.1f %12.1f %6.2fx\n",
+			       "memcpy", lens[i], offs[j][0], offs[j][1],
+			       byte, opt, byte / opt);
+		}
+	}
+
+	for (i = 0U; i < (sizeof(lens) / sizeof(lens[0])); i++) {
+		/* Backward copies, the source overlapping from below */
+		byte = time_copy(byte_memmove, 0U, 8U, lens[i]);
+		opt = time_copy(tf_memmove, 0U, 8U, lens[i]);
+		printf("%-8s %8zu %3u/%-3u %12.1f %12.1f %6.2fx\n",
+		       "memmove", lens[i], 0U, 8U, byte, opt, byte / opt);
+	}
+
+	for (i = 0U; i < (sizeof(lens) / sizeof(lens[0])); i++) {
+		for (j = 0U; j < 2U; j++) {
+			byte = time_set(j, lens[i], 0);
+			opt = time_set(j, lens[i], 1);
+			printf("%-8s %8zu   -/%-3zu %12.1f %12.1f %6.2fx\n",
+			       "memset", lens[i], j, byte, opt, byte / opt);
+		}
+	}
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "Usage : %s [-b]\n", prog);
+}
+
+int main(int argc, char *argv[])
+{
+	int opt, bench = 0, fails, total = 0;
+
+	while ((opt = getopt(argc, argv, "b")) != -1) {
+		switch (opt) {
+		case 'b':
+			bench = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	src_buf = malloc(BUF_SIZE);
+	test_buf = malloc(BUF_SIZE);
+	ref_buf = malloc(BUF_SIZE);
+	if ((src_buf == NULL) || (test_buf == NULL) || (ref_buf == NULL)) {
+		fprintf(stderr, "Can't allocate test buffers\n");
+		return 1;
+	}
+
+	srand(1);
+	fill_random(src_buf, BUF_SIZE);
+
+	if (bench) {
+		benchmark();
+		return 0;
+	}
+
+	fails = check_memcpy();
+	printf("memcpy:  %d failures\n", fails);
+	total += fails;
+
+	fails = check_memmove();
+	printf("memmove: %d failures\n", fails);
+	total += fails;
+
+	fails = check_memset();
+	printf("memset:  %d failures\n", fails);
+	total += fails;
+
+	free(ref_buf);
+	free(test_buf);
+	free(src_buf);
+
+	return (total == 0) ? 0 : 1;
+}
@@ -0,0 +1,340 @@
+/*
+ * Copyright (c) 2020, ARM Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/*
+ * Host test of the asynchronous reads of drivers/mmc/mmc.c, started with
+ * mmc_read_blocks_start() and ended with mmc_read_blocks_poll() or
+ * mmc_read_blocks_wait(), driven through a fake struct mmc_ops. The driver
+ * is included, so that its state can be set up as after mmc_init(). It is
+ * built against the TF-A headers, and linked with the host C library.
+ */
+
+#include "mmc.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define DISK_BLOCKS	64U
+#define MAX_CMDS	16U
+
+static uint8_t disk[DISK_BLOCKS * MMC_BLOCK_SIZE];
+static uint8_t buffer[DISK_BLOCKS * MMC_BLOCK_SIZE];
+
+/* Fake controller state */
+static struct {
+	unsigned int cmds[MAX_CMDS];	/* indexes of the commands sent */
+	unsigned int nb_cmds;
+	unsigned int nb_read;		/* blocking ops->read() calls */
+	unsigned int nb_poll;		/* ops->read_poll() calls */
+	int busy_polls;			/* polls returning -EBUSY */
+	int prepare_error;
+	int data_error;			/* returned when the data is in */
+	unsigned int status_error;	/* CMD13 error bits */
+	bool inflight;
+	int lba;
+	uintptr_t buf;
+	size_t size;
+} fake;
+
+static int fails;
+
+void mdelay(uint32_t msec)
+{
+}
+
+void udelay(uint32_t usec)
+{
+}
+
+void zeromem(void *mem, u_register_t length)
+{
+	memset(mem, 0, length);
+}
+
+void __assert(const char *file, unsigned int line)
+{
+	printf("ASSERT %s:%u\n", file, line);
+	exit(1);
+	__builtin_unreachable();
+}
+
+static void fake_transfer(void)
+{
+	memcpy((void *)fake.buf, &disk[fake.lba * MMC_BLOCK_SIZE], fake.size);
+	fake.inflight = false;
+}
+
+static int fake_send_cmd(struct mmc_cmd *cmd)
+{
+	if (fake.nb_cmds < MAX_CMDS) {
+		fake.cmds[fake.nb_cmds] = cmd->cmd_idx;
+	}
+	fake.nb_cmds++;
+
+	switch (cmd->cmd_idx) {
+	case MMC_CMD(13):
+		cmd->resp_data[0] = (MMC_STATE_TRAN << 9) |
+				    STATUS_READY_FOR_DATA | fake.status_error;
+		break;
+	case MMC_CMD(17):
+	case MMC_CMD(18):
+		fake.lba = cmd->cmd_arg;
+		fake.inflight = true;
+		break;
+	default:
+		break;
+	}
+
+	return 0;
+}
+
+static int fake_prepare(int lba, uintptr_t buf, size_t size)
+{
+	fake.buf = buf;
+	fake.size = size;
+
+	return fake.prepare_error;
+}
+
+static int fake_read(int lba, uintptr_t buf, size_t size)
+{
+	fake.nb_read++;
+	if (fake.inflight) {
+		fake_transfer();
+	}
+
+	return fake.data_error;
+}
+
+static int fake_read_poll(int lba, uintptr_t buf, size_t size)
+{
+	fake.nb_poll++;
+	if (fake.busy_polls > 0) {
+		fake.busy_polls--;
+		return -EBUSY;
+	}
+	if (fake.inflight) {
+		fake_transfer();
+	}
+
+	return fake.data_error;
+}
+
+static struct mmc_ops fake_ops = {
+	.send_cmd	= fake_send_cmd,
+	.prepare	= fake_prepare,
+	.read		= fake_read,
+	.read_poll	= fake_read_poll,
+};
+
+static struct mmc_device_info fake_dev_info = {
+	.mmc_dev_type	= MMC_IS_EMMC,
+};
+
+static void setup(bool poll)
+{
+	memset(&fake, 0, sizeof(fake));
+	memset(buffer, 0, sizeof(buffer));
+	fake_ops.read_poll = poll ? fake_read_poll : NULL;
+
+	/* Sector addressed eMMC, without CMD23: CMD18 is ended by CMD12 */
+	ops = &fake_ops;
+	mmc_dev_info = &fake_dev_info;
+	mmc_ocr_value = OCR_SECTOR_MODE;
+	mmc_flags = 0U;
+}
+
+#define CHECK(cond)							\
+	do {								\
+		if (!(cond)) {						\
+			printf("%s:%d: %s failed\n", __func__,		\
+			       __LINE__, #cond);			\
+			fails++;					\
+		}							\
+	} while (0)
+
+static bool data_ok(int lba, size_t size)
+{
+	return memcmp(buffer, &disk[lba * MMC_BLOCK_SIZE], size) == 0;
+}
+
+/* poll returns -EBUSY while the data is in flight, then completes */
+static void test_poll_busy(void)
+{
+	struct mmc_read_req req;
+	size_t size = 8U * MMC_BLOCK_SIZE;
+	int i;
+
+	setup(true);
+	fake.busy_polls = 3;
+
+	CHECK(mmc_read_blocks_start(&req, 5, (uintptr_t)buffer, size) == 0);
+	CHECK(fake.nb_cmds == 1U);
+	CHECK(fake.cmds[0] == MMC_CMD(18));
+
+	for (i = 0; i < 3; i++) {
+		CHECK(mmc_read_blocks_poll(&req) == -EBUSY);
+	}
+	/* No status check or stop command before the data is in */
+	CHECK(fake.nb_cmds == 1U);
+
+	CHECK(mmc_read_blocks_poll(&req) == 0);
+	CHECK(data_ok(5, size));
+	CHECK(fake.nb_cmds == 3U);
+	CHECK(fake.cmds[1] == MMC_CMD(13));
+	CHECK(fake.cmds[2] == MMC_CMD(12));
+
+	/* Further polls return the final status without driver calls */
+	CHECK(mmc_read_blocks_poll(&req) == 0);
+	CHECK(fake.nb_poll == 4U);
+	CHECK(fake.nb_read == 0U);
+}
+
+/* wait after poll has ended the read just returns its size */
+static void test_wait_after_poll(void)
+{
+	struct mmc_read_req req;
+	size_t size = 4U * MMC_BLOCK_SIZE;
+
+	setup(true);
+	fake.busy_polls = 1;
+
+	CHECK(mmc_read_blocks_start(&req, 9, (uintptr_t)buffer, size) == 0);
+	CHECK(mmc_read_blocks_poll(&req) == -EBUSY);
+	CHECK(mmc_read_blocks_poll(&req) == 0);
+	CHECK(mmc_read_blocks_wait(&req) == size);
+	CHECK(data_ok(9, size));
+	CHECK(fake.nb_read == 0U);
+	CHECK(fake.nb_cmds == 3U);
+}
+
+/* wait on a read still in flight blocks in ops->read() */
+static void test_wait_inflight(void)
+{
+	struct mmc_read_req req;
+
+	setup(true);
+	fake.busy_polls = 100;
+
+	CHECK(mmc_read_blocks_start(&req, 0, (uintptr_t)buffer,
+				    MMC_BLOCK_SIZE) == 0);
+	CHECK(mmc_read_blocks_wait(&req) == MMC_BLOCK_SIZE);
+	CHECK(data_ok(0, MMC_BLOCK_SIZE));
+	CHECK(fake.nb_read == 1U);
+	/* Single block: CMD17, CMD13 and no CMD12 */
+	CHECK(fake.nb_cmds == 2U);
+	CHECK(fake.cmds[0] == MMC_CMD(17));
+	CHECK(mmc_read_blocks_poll(&req) == 0);
+	CHECK(fake.nb_poll == 0U);
+}
+
+/* A zero-size read completes at once, without any command */
+static void test_zero_size(void)
+{
+	struct mmc_read_req req;
+
+	setup(true);
+
+	CHECK(mmc_read_blocks_start(&req, 3, (uintptr_t)buffer, 0U) == 0);
+	CHECK(mmc_read_blocks_poll(&req) == 0);
+	CHECK(mmc_read_blocks_wait(&req) == 0U);
+	CHECK(fake.nb_cmds == 0U);
+	CHECK((fake.nb_poll == 0U) && (fake.nb_read == 0U));
+}
+
+/* Errors reported when the data is in, or by the final status check */
+static void test_completion_errors(void)
+{
+	struct mmc_read_req req;
+	size_t size = 2U * MMC_BLOCK_SIZE;
+
+	setup(true);
+	fake.busy_polls = 1;
+	fake.data_error = -EIO;
+
+	CHECK(mmc_read_blocks_start(&req, 1, (uintptr_t)buffer, size) == 0);
+	CHECK(mmc_read_blocks_poll(&req) == -EBUSY);
+	CHECK(mmc_read_blocks_poll(&req) == -EIO);
+	CHECK(mmc_read_blocks_poll(&req) == -EIO);
+	CHECK(mmc_read_blocks_wait(&req) == 0U);
+	CHECK(fake.nb_read == 0U);
+	/* The read is not stopped when the data transfer failed */
+	CHECK(fake.nb_cmds == 1U);
+
+	setup(true);
+	fake.data_error = -ETIMEDOUT;
+
+	CHECK(mmc_read_blocks_start(&req, 1, (uintptr_t)buffer, size) == 0);
+	CHECK(mmc_read_blocks_wait(&req) == 0U);
+	CHECK(mmc_read_blocks_poll(&req) == -ETIMEDOUT);
+
+	setup(true);
+	fake.status_error = STATUS_SWITCH_ERROR;
+
+	CHECK(mmc_read_blocks_start(&req, 1, (uintptr_t)buffer, size) == 0);
+	CHECK(mmc_read_blocks_poll(&req) == -EIO);
+	CHECK(mmc_read_blocks_wait(&req) == 0U);
+}
+
+/* A failure to submit the read is returned by start */
+static void test_submit_error(void)
+{
+	struct mmc_read_req req;
+
+	setup(true);
+	fake.prepare_error = -EINVAL;
+
+	CHECK(mmc_read_blocks_start(&req, 1, (uintptr_t)buffer,
+				    MMC_BLOCK_SIZE) == -EINVAL);
+	CHECK(mmc_read_blocks_poll(&req) == -EINVAL);
+	CHECK(mmc_read_blocks_wait(&req) == 0U);
+	CHECK(fake.nb_cmds == 0U);
+}
+
+/* Without read_poll, start completes the read synchronously */
+static void test_no_poll(void)
+{
+	struct mmc_read_req req;
+	size_t size = 16U * MMC_BLOCK_SIZE;
+
+	setup(false);
+
+	CHECK(mmc_read_blocks_start(&req, 20, (uintptr_t)buffer, size) == 0);
+	CHECK(data_ok(20, size));
+	CHECK(fake.nb_read == 1U);
+	CHECK(fake.nb_cmds == 3U);
+	CHECK(mmc_read_blocks_poll(&req) == 0);
+	CHECK(mmc_read_blocks_wait(&req) == size);
+	CHECK(fake.nb_read == 1U);
+
+	setup(false);
+	fake.data_error = -EIO;
+
+	CHECK(mmc_read_blocks_start(&req, 20, (uintptr_t)buffer, size) ==
+	      -EIO);
+	CHECK(mmc_read_blocks_wait(&req) == 0U);
+}
+
+int main(void)
+{
+	unsigned int i;
+
+	for (i = 0U; i < sizeof(disk); i++) {
+		disk[i] = (uint8_t)(i * 7U + (i >> 9));
+	}
+
+	test_poll_busy();
+	test_wait_after_poll();
+	test_wait_inflight();
+	test_zero_size();
+	test_completion_errors();
+	test_submit_error();
+	test_no_poll();
+
+	printf("mmc async reads: %d failures\n", fails);
+
+	return (fails == 0) ? 0 : 1;
+}
@@ -0,0 +1,13 @@
+/*
+ * Copyright (c) 2020, ARM Limited and Contributors. All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef PLATFORM_DEF_H
+#define PLATFORM_DEF_H
+
+/* Only used by assert.h: report the file and line of failed assertions */
+#define PLAT_LOG_LEVEL_ASSERT	40
+
+#endif /* PLATFORM_DEF_H */
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2020, STMicroelectronics - All Rights Reserved
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/*
+ * Host test of the Hamming syndrome helpers of the STM32MP1 NAND driver
+ * (drivers/st/nand/nand_hamming.h), against bitwise references:
+ * - the bit count, for all 24-bit syndromes and random 32-bit words,
+ * - the single data error check and its address, for all 24-bit syndromes,
+ * - the address of each single bit flip of random 512-byte sectors, with an
+ *   ECC computed bit by bit.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nand_hamming.h"
+
+#define SECTOR_SIZE		512U
+#define SECTOR_BITS		(SECTOR_SIZE * 8U)
+#define ADDRESS_BITS		12U
+#define RANDOM_WORDS		10000000U
+#define RANDOM_SECTORS		16U
+
+static uint32_t ref_bit_count(uint32_t v)
+{
+	uint32_t i, c = 0U;
+
+	for (i = 0U; i < 32U; i++) {
+		c += (v >> i) & 1U;
+	}
+
+	return c;
+}
+
+static bool ref_data_error(uint32_t syndrome)
+{
+	uint32_t k;
+
+	for (k = 0U; k < ADDRESS_BITS; k++) {
+		if (((syndrome >> (2U * k)) & 1U) ==
+		    ((syndrome >> (2U * k + 1U)) & 1U)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static uint32_t ref_error_address(uint32_t syndrome)
+{
+	uint32_t k, address = 0U;
+
+	for (k = 0U; k < ADDRESS_BITS; k++) {
+		address |= ((syndrome >> (2U * k + 1U)) & 1U) << k;
+	}
+
+	return address;
+}
+
+/* 24-bit Hamming ECC of a sector, as computed by the FMC2 */
+static uint32_t ref_ecc(const uint8_t *sector)
+{
+	uint32_t address, k, ecc = 0U;
+
+	for (address = 0U; address < SECTOR_BITS; address++) {
+		if (((sector[address >> 3] >> (address & 7U)) & 1U) == 0U) {
+			continue;
+		}
+		for (k = 0U; k < ADDRESS_BITS; k++) {
+			ecc ^= 1U << (2U * k + ((address >> k) & 1U));
+		}
+	}
+
+	return ecc;
+}
+
+static int check_bit_count(void)
+{
+	uint32_t v, i;
+	int fails = 0;
+
+	for (v = 0U; v <= NAND_HAMMING_SYNDROME_MASK; v++) {
+		if (nand_hamming_bit_count(v) != ref_bit_count(v)) {
+			fails++;
+		}
+	}
+
+	srand(1);
+	for (i = 0U; i < RANDOM_WORDS; i++) {
+		v = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+		if (nand_hamming_bit_count(v) != ref_bit_count(v)) {
+			fails++;
+		}
+	}
+
+	if (nand_hamming_bit_count(UINT32_MAX) != 32U) {
+		fails++;
+	}
+
+	return fails;
+}
+
+static int check_syndromes(void)
+{
+	uint32_t syndrome, errors = 0U;
+	int fails = 0;
+
+	for (syndrome = 0U; syndrome <= NAND_HAMMING_SYNDROME_MASK;
+	     syndrome++) {
+		bool data_error = nand_hamming_data_error(syndrome);
+
+		if (data_error != ref_data_error(syndrome)) {
+			fails++;
+			continue;
+		}
+		if (!data_error) {
+			continue;
+		}
+
+		errors++;
+		if (nand_hamming_error_address(syndrome) !=
+		    ref_error_address(syndrome)) {
+			fails++;
+		}
+	}
+
+	/* One syndrome per data bit of the sector */
+	if (errors != SECTOR_BITS) {
+		fails++;
+	}
+
+	return fails;
+}
+
+static int check_sectors(void)
+{
+	uint8_t sector[SECTOR_SIZE];
+	uint32_t ecc, syndrome, address, i, j;
+	int fails = 0;
+
+	srand(2);
+	for (i = 0U; i < RANDOM_SECTORS; i++) {
+		for (j = 0U; j < SECTOR_SIZE; j++) {
+			sector[j] = (uint8_t)rand();
+		}
+		ecc = ref_ecc(sector);
+
+		for (address = 0U; address < SECTOR_BITS; address++) {
+			sector[address >> 3] ^= 1U << (address & 7U);
+			syndrome = ref_ecc(sector) ^ ecc;
+			sector[address >> 3] ^= 1U << (address & 7U);
+
+			if (!nand_hamming_data_error(syndrome) ||
+			    (nand_hamming_error_address(syndrome) != address)) {
+				fails++;
+			}
+		}
+	}
+
+	return fails;
+}
+
+int main(void)
+{
+	int fails, total = 0;
+
+	fails = check_bit_count();
+	printf("bit count:         %d failures\n", fails);
+	total += fails;
+
+	fails = check_syndromes();
+	printf("syndrome decoding: %d failures\n", fails);
+	total += fails;
+
+	fails = check_sectors();
+	printf("sector bit flips:  %d failures\n", fails);
+	total += fails;
+
+	return (total == 0) ? 0 : 1;
+}
@@ -7,15 +7,17 @@
 #include <asm/byteorder.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <getopt.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <stm32image_checksum.h>
+
 /* Magic = 'S' 'T' 'M' 0x32 */
 #define HEADER_MAGIC		__be32_to_cpu(0x53544D32)
 #define VER_MAJOR		2
@@ -27,6 +29,12 @@
 /* Default option : bit0 => no signature */
 #define HEADER_DEFAULT_OPTION	(__cpu_to_le32(0x00000001))
 
+/* Payloads are read, summed and written by blocks of this size */
+#define STREAM_BLOCK_SIZE	(1024 * 1024)
+
+#define BATCH_LINE_MAX_LEN	4096
+#define BATCH_MAX_ARGS		32
+
 struct stm32_header {
 	uint32_t magic_number;
 	uint8_t image_signature[64];
@@ -45,6 +53,19 @@ struct stm32_header {
 	uint8_t binary_type;
 };
 
+struct stm32image_args {
+	char *src;
+	char *dest;
+	int loadaddr;
+	int entry;
+	int version;
+};
+
+static const struct option long_opts[] = {
+	{ "batch", required_argument, NULL, 'b' },
+	{ NULL, 0, NULL, 0 }
+};
+
 static void stm32image_default_header(struct stm32_header *ptr)
 {
 	if (!ptr) {
@@ -59,28 +80,6 @@ static void stm32image_default_header(struct stm32_header *ptr)
 	ptr->binary_type = TF_BINARY_TYPE;
 }
 
-static uint32_t stm32image_checksum(void *start, uint32_t len)
-{
-	uint32_t csum = 0;
-	uint32_t hdr_len = sizeof(struct stm32_header);
-	uint8_t *p;
-
-	if (len < hdr_len) {
-		return 0;
-	}
-
-	p = (unsigned char *)start + hdr_len;
-	len -= hdr_len;
-
-	while (len > 0) {
-		csum += *p;
-		p++;
-		len--;
-	}
-
-	return csum;
-}
-
 static void stm32image_print_header(const void *ptr)
 {
 	struct stm32_header *stm32hdr = (struct stm32_header *)ptr;
@@ -102,38 +101,102 @@ static void stm32image_print_header(const void *ptr)
 	       __le32_to_cpu(stm32hdr->version_number));
 }
 
-static void stm32image_set_header(void *ptr, struct stat *sbuf, int ifd,
+static void stm32image_set_header(struct stm32_header *stm32hdr,
+				  uint32_t length, uint32_t checksum,
 				  uint32_t loadaddr, uint32_t ep, uint32_t ver)
 {
-	struct stm32_header *stm32hdr = (struct stm32_header *)ptr;
-
 	stm32image_default_header(stm32hdr);
 
 	stm32hdr->load_address = __cpu_to_le32(loadaddr);
 	stm32hdr->image_entry_point = __cpu_to_le32(ep);
-	stm32hdr->image_length = __cpu_to_le32((uint32_t)sbuf->st_size -
-					     sizeof(struct stm32_header));
-	stm32hdr->image_checksum =
-		__cpu_to_le32(stm32image_checksum(ptr, sbuf->st_size));
+	stm32hdr->image_length = __cpu_to_le32(length);
+	stm32hdr->image_checksum = __cpu_to_le32(checksum);
 	stm32hdr->version_number = __cpu_to_le32(ver);
 }
 
+/*
+ * Copy the payload block by block after the header, from src_fd offset 0 to
+ * dest_fd offset sizeof(struct stm32_header). Each block is read once, then
+ * summed and written from the same buffer. Only one block is held in memory,
+ * whatever the image size.
+ */
+static int stm32image_copy_payload(int src_fd, const char *srcname,
+				   int dest_fd, const char *destname,
+				   uint32_t *length, uint32_t *checksum)
+{
+	uint8_t *buf;
+	off_t size = 0;
+	uint32_t csum = 0U;
+	ssize_t len, ret, done;
+	int err = -1;
+
+	buf = malloc(STREAM_BLOCK_SIZE);
+	if (buf == NULL) {
+		fprintf(stderr, "Can't allocate block buffer\n");
+		return -1;
+	}
+
+	for (;;) {
+		len = pread(src_fd, buf, STREAM_BLOCK_SIZE, size);
+		if (len < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			fprintf(stderr, "Read error on %s: %s\n", srcname,
+				strerror(errno));
+			goto out;
+		}
+
+		if (len == 0) {
+			break;
+		}
+
+		if ((uint64_t)size + len >
+		    UINT32_MAX - sizeof(struct stm32_header)) {
+			fprintf(stderr, "%s is too large\n", srcname);
+			goto out;
+		}
+
+		csum += stm32image_payload_checksum(buf, len);
+
+		done = 0;
+		while (done < len) {
+			ret = pwrite(dest_fd, buf + done, len - done,
+				     size + sizeof(struct stm32_header) + done);
+			if (ret < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+
+				fprintf(stderr, "Write error on %s: %s\n",
+					destname, strerror(errno));
+				goto out;
+			}
+
+			done += ret;
+		}
+
+		size += len;
+	}
+
+	*length = (uint32_t)size;
+	*checksum = csum;
+	err = 0;
+
+out:
+	free(buf);
+	return err;
+}
+
 static int stm32image_create_header_file(char *srcname, char *destname,
 					 uint32_t loadaddr, uint32_t entry,
 					 uint32_t version)
 {
 	int src_fd, dest_fd;
-	struct stat sbuf;
-	unsigned char *ptr;
+	uint32_t length, checksum;
 	struct stm32_header stm32image_header;
 
-	dest_fd = open(destname, O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0666);
-	if (dest_fd == -1) {
-		fprintf(stderr, "Can't open %s: %s\n", destname,
-			strerror(errno));
-		return -1;
-	}
-
 	src_fd = open(srcname, O_RDONLY);
 	if (src_fd == -1) {
 		fprintf(stderr, "Can't open %s: %s\n", srcname,
@@ -141,107 +204,238 @@ static int stm32image_create_header_file(char *srcname, char *destname,
 		return -1;
 	}
 
-	if (fstat(src_fd, &sbuf) < 0) {
+	/* No O_APPEND: pwrite() would ignore the offsets, header included */
+	dest_fd = open(destname, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (dest_fd == -1) {
+		fprintf(stderr, "Can't open %s: %s\n", destname,
+			strerror(errno));
+		close(src_fd);
 		return -1;
 	}
 
-	ptr = mmap(NULL, sbuf.st_size, PROT_READ, MAP_SHARED, src_fd, 0);
-	if (ptr == MAP_FAILED) {
-		fprintf(stderr, "Can't read %s\n", srcname);
-		return -1;
+	if (stm32image_copy_payload(src_fd, srcname, dest_fd, destname,
+				    &length, &checksum) != 0) {
+		goto err;
 	}
 
 	memset(&stm32image_header, 0, sizeof(struct stm32_header));
+	stm32image_set_header(&stm32image_header, length, checksum,
+			      loadaddr, entry, version);
 
-	if (write(dest_fd, &stm32image_header, sizeof(struct stm32_header)) !=
-	    sizeof(struct stm32_header)) {
-		fprintf(stderr, "Write error %s: %s\n", destname,
+	if (pwrite(dest_fd, &stm32image_header, sizeof(struct stm32_header),
+		   0) != sizeof(struct stm32_header)) {
+		fprintf(stderr, "Write error on %s: %s\n", destname,
 			strerror(errno));
-		return -1;
+		goto err;
 	}
 
-	if (write(dest_fd, ptr, sbuf.st_size) != sbuf.st_size) {
+	if (close(dest_fd) != 0) {
 		fprintf(stderr, "Write error on %s: %s\n", destname,
 			strerror(errno));
+		close(src_fd);
 		return -1;
 	}
 
-	munmap((void *)ptr, sbuf.st_size);
 	close(src_fd);
 
-	if (fstat(dest_fd, &sbuf) < 0) {
-		return -1;
-	}
+	stm32image_print_header(&stm32image_header);
 
-	ptr = mmap(0, sbuf.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
-		   dest_fd, 0);
-
-	if (ptr == MAP_FAILED) {
-		fprintf(stderr, "Can't read %s\n", srcname);
-		return -1;
-	}
-
-	stm32image_set_header(ptr, &sbuf, dest_fd, loadaddr, entry, version);
-
-	stm32image_print_header(ptr);
+	return 0;
 
-	munmap((void *)ptr, sbuf.st_size);
+err:
 	close(dest_fd);
-	return 0;
+	close(src_fd);
+	return -1;
 }
 
-int main(int argc, char *argv[])
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage : %s [-s srcfile] [-d destfile] [-l loadaddr] [-e entry_point] [-v version]\n"
+		"        %s [-b|--batch file] [-l loadaddr] [-e entry_point] [-v version]\n",
+		prog, prog);
+}
+
+/*
+ * Parse the image options into args. The batch file option is only accepted
+ * when batch is not NULL, i.e. from the command line.
+ */
+static int stm32image_parse_args(int argc, char *argv[],
+				 struct stm32image_args *args,
+				 char **batch)
 {
-	int opt, loadaddr = -1, entry = -1, err = 0, version = 0;
-	char *dest = NULL, *src = NULL;
+	int opt;
 
-	while ((opt = getopt(argc, argv, ":s:d:l:e:v:")) != -1) {
+	/* Restart the option scanning from the first argument */
+	optind = 0;
+	while ((opt = getopt_long(argc, argv, ":s:d:l:e:v:b:", long_opts,
+				  NULL)) != -1) {
 		switch (opt) {
 		case 's':
-			src = optarg;
+			args->src = optarg;
 			break;
 		case 'd':
-			dest = optarg;
+			args->dest = optarg;
 			break;
 		case 'l':
-			loadaddr = strtol(optarg, NULL, 0);
+			args->loadaddr = strtol(optarg, NULL, 0);
 			break;
 		case 'e':
-			entry = strtol(optarg, NULL, 0);
+			args->entry = strtol(optarg, NULL, 0);
 			break;
 		case 'v':
-			version = strtol(optarg, NULL, 0);
+			args->version = strtol(optarg, NULL, 0);
 			break;
+		case 'b':
+			if (batch != NULL) {
+				*batch = optarg;
+				break;
+			}
+			/* Fallthrough */
 		default:
-			fprintf(stderr,
-				"Usage : %s [-s srcfile] [-d destfile] [-l loadaddr] [-e entry_point]\n",
-					argv[0]);
 			return -1;
 		}
 	}
 
-	if (!src) {
+	return 0;
+}
+
+static int stm32image_check_args(const struct stm32image_args *args)
+{
+	if (!args->src) {
 		fprintf(stderr, "Missing -s option\n");
 		return -1;
 	}
 
-	if (!dest) {
+	if (!args->dest) {
 		fprintf(stderr, "Missing -d option\n");
 		return -1;
 	}
 
-	if (loadaddr == -1) {
+	if (args->loadaddr == -1) {
 		fprintf(stderr, "Missing -l option\n");
 		return -1;
 	}
 
-	if (entry == -1) {
+	if (args->entry == -1) {
 		fprintf(stderr, "Missing -e option\n");
 		return -1;
 	}
 
-	err = stm32image_create_header_file(src, dest, loadaddr,
-					    entry, version);
+	return 0;
+}
+
+/*
+ * Create one image per line of the batch file. Each line holds -s, -d, -l, -e
+ * and -v options, in the same format as the command line, which override the
+ * ones given in the command line for this image only. Empty lines and lines
+ * starting with '#' are skipped. Processing stops at the first error.
+ */
+static int stm32image_batch(const char *fn, const struct stm32image_args *defs)
+{
+	struct stm32image_args args;
+	char line[BATCH_LINE_MAX_LEN];
+	char *argv[BATCH_MAX_ARGS];
+	unsigned int line_num = 0U, nb_images = 0U;
+	FILE *file;
+	char *p;
+	int argc, err = -1;
+
+	file = fopen(fn, "r");
+	if (file == NULL) {
+		fprintf(stderr, "Can't open %s: %s\n", fn, strerror(errno));
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), file) != NULL) {
+		line_num++;
+
+		if ((strchr(line, '\n') == NULL) && !feof(file)) {
+			fprintf(stderr, "%s:%u: line too long\n", fn, line_num);
+			goto out;
+		}
+
+		/* Split the line into arguments, after a dummy program name */
+		argc = 0;
+		argv[argc++] = (char *)fn;
+		for (p = strtok(line, " \t\r\n"); p != NULL;
+		     p = strtok(NULL, " \t\r\n")) {
+			if (argc == BATCH_MAX_ARGS - 1) {
+				fprintf(stderr, "%s:%u: too many arguments\n",
+					fn, line_num);
+				goto out;
+			}
+			argv[argc++] = p;
+		}
+		argv[argc] = NULL;
+
+		if ((argc == 1) || (argv[1][0] == '#')) {
+			continue;
+		}
+
+		args = *defs;
+		if ((stm32image_parse_args(argc, argv, &args, NULL) != 0) ||
+		    (optind != argc)) {
+			fprintf(stderr, "%s:%u: invalid arguments\n", fn,
+				line_num);
+			goto out;
+		}
+
+		if (stm32image_check_args(&args) != 0) {
+			fprintf(stderr, "%s:%u: incomplete image options\n",
+				fn, line_num);
+			goto out;
+		}
+
+		printf("Creating %s from %s\n", args.dest, args.src);
+		if (stm32image_create_header_file(args.src, args.dest,
+						  args.loadaddr, args.entry,
+						  args.version) != 0) {
+			fprintf(stderr, "%s:%u: can't create %s\n", fn,
+				line_num, args.dest);
+			goto out;
+		}
+
+		nb_images++;
+	}
+
+	if (ferror(file)) {
+		fprintf(stderr, "Read error on %s\n", fn);
+		goto out;
+	}
+
+	printf("%u images created\n", nb_images);
+	err = 0;
 
+out:
+	fclose(file);
 	return err;
 }
+
+int main(int argc, char *argv[])
+{
+	struct stm32image_args args = {
+		.src = NULL,
+		.dest = NULL,
+		.loadaddr = -1,
+		.entry = -1,
+		.version = 0,
+	};
+	char *batch = NULL;
+
+	if (stm32image_parse_args(argc, argv, &args, &batch) != 0) {
+		usage(argv[0]);
+		return -1;
+	}
+
+	if (batch != NULL) {
+		return stm32image_batch(batch, &args);
+	}
+
+	if (stm32image_check_args(&args) != 0) {
+		return -1;
+	}
+
+	return stm32image_create_header_file(args.src, args.dest, args.loadaddr,
+					     args.entry, args.version);
+}
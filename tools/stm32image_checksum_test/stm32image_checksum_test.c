@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2020, STMicroelectronics - All Rights Reserved
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/*
+ * Host test of stm32image_payload_checksum() (include/tools_share/
+ * stm32image_checksum.h), used by BL2 and the stm32image tool, against a
+ * byte by byte sum:
+ * - random payloads of every length up to a few folds, at all alignments,
+ * - all-0xFF payloads, which fill the 16-bit lanes the most,
+ * - a few large payloads.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <stm32image_checksum.h>
+
+#define FOLD_LEN	(STM32IMAGE_CHECKSUM_FOLD_WORDS * sizeof(uint32_t))
+#define MAX_SMALL_LEN	(3U * FOLD_LEN + 7U)
+#define ALIGNMENTS	8U
+#define LARGE_LEN	(16U * 1024U * 1024U + 3U)
+
+static uint32_t ref_checksum(const uint8_t *buf, size_t len)
+{
+	uint32_t csum = 0U;
+	size_t i;
+
+	for (i = 0U; i < len; i++) {
+		csum += buf[i];
+	}
+
+	return csum;
+}
+
+/* Check every length up to max_len at every alignment of buf */
+static int check_lengths(const uint8_t *buf, size_t max_len)
+{
+	size_t len, align;
+	int fails = 0;
+
+	for (align = 0U; align < ALIGNMENTS; align++) {
+		for (len = 0U; len <= max_len; len++) {
+			if (stm32image_payload_checksum(buf + align, len) !=
+			    ref_checksum(buf + align, len)) {
+				fails++;
+			}
+		}
+	}
+
+	return fails;
+}
+
+static int check_large(uint8_t *buf)
+{
+	const size_t lens[] = {
+		FOLD_LEN * 1024U, FOLD_LEN * 1024U + 1U, 1000003U, LARGE_LEN,
+	};
+	size_t i, align;
+	int fails = 0;
+
+	for (i = 0U; i < (sizeof(lens) / sizeof(lens[0])); i++) {
+		for (align = 0U; align < ALIGNMENTS; align++) {
+			if (stm32image_payload_checksum(buf + align, lens[i]) !=
+			    ref_checksum(buf + align, lens[i])) {
+				fails++;
+			}
+		}
+	}
+
+	return fails;
+}
+
+int main(void)
+{
+	uint8_t *buf;
+	size_t i;
+	int fails, total = 0;
+
+	/* malloc() aligns buf, so buf + align covers every word alignment */
+	buf = malloc(LARGE_LEN + ALIGNMENTS);
+	if (buf == NULL) {
+		fprintf(stderr, "Can't allocate test buffer\n");
+		return 1;
+	}
+
+	srand(1);
+	for (i = 0U; i < (LARGE_LEN + ALIGNMENTS); i++) {
+		buf[i] = (uint8_t)rand();
+	}
+
+	fails = check_lengths(buf, MAX_SMALL_LEN);
+	printf("random payloads: %d failures\n", fails);
+	total += fails;
+
+	fails = check_large(buf);
+	printf("large payloads:  %d failures\n", fails);
+	total += fails;
+
+	memset(buf, 0xFF, LARGE_LEN + ALIGNMENTS);
+
+	fails = check_lengths(buf, MAX_SMALL_LEN);
+	printf("0xFF payloads:   %d failures\n", fails);
+	total += fails;
+
+	fails = check_large(buf);
+	printf("large 0xFF:      %d failures\n", fails);
+	total += fails;
+
+	free(buf);
+
+	return (total == 0) ? 0 : 1;
+}